@@ -14,6 +14,19 @@ BuildRoot: %{_tmppath}/%{name}-%{version}-%{release}-build
      clients that access memory pages with configurable patterns.
    - `cpuload' generates CPU load according to specified value.
    - `memload' allocates configurable amount of memory.
+   - `cacheload' streams files through the page cache at a given rate.
+   - `forkload' creates processes or threads at a given rate and reports
+     spawn latency.
+   - `mmapload' churns mappings and page faults in one address space and
+     reports their latency and TLB shootdowns.
+   - `ipcload' passes wakeups between threads or processes over pipes,
+     sockets, eventfd or futexes and reports round trip latency.
+   - `lockload' makes threads contend on locks or shared cache lines and
+     reports per-thread rates and fairness.
+   - `netload' runs TCP, UDP or UNIX socket flows over loopback and
+     reports throughput and round trip latency.
+   - `metaload' creates, stats, renames and unlinks small files from many
+     threads and reports metadata operation latencies.
    - `flash_eater' allocates disk space on the filesystem so that only a
      configurable amount of free space will be left.
    - `run_secs' allows execution of given command for a configurable time
@@ -38,8 +51,15 @@ rm -rf %{buildroot}
 %{_bindir}/swpload
 %{_bindir}/memload
 %{_bindir}/cpuload
+%{_bindir}/cacheload
 %{_bindir}/run_secs
 %{_bindir}/flash_eater
+%{_bindir}/forkload
+%{_bindir}/mmapload
+%{_bindir}/ipcload
+%{_bindir}/lockload
+%{_bindir}/netload
+%{_bindir}/metaload
 %{_mandir}/man1/*.1.gz
 %doc doc/README COPYING 
 
@@ -0,0 +1,553 @@
+/* ========================================================================= *
+ * File: cacheload.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Page cache pressure generator. Streams a set of files through the
+ *    page cache using buffered read() or mmap() at a limited rate, either
+ *    once or over and over again, and reports how much of the files is
+ *    resident in the page cache (cachestat(2) if available, mincore(2)
+ *    otherwise). Together with memload this allows to keep a given amount
+ *    of clean page cache churning against anonymous memory.
+ *
+ *    Examples:
+ *      cacheload -s 512 -r 50 /tmp/c1 /tmp/c2 - create two 512 MB files
+ *        and read them repeatedly at 50 MB/s
+ *      cacheload -1 -m -a dontneed big.img - one mmap scan of big.img,
+ *        dropping pages behind
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ========================================================================= *
+ * General settings.
+ * ========================================================================= */
+
+#define CL_CHUNK          (1 << 20)   /* Bytes read or touched in one step       */
+#define CL_REPORT         5           /* Default residency report period, seconds */
+
+#define CL_CAPACITY(a)    (sizeof(a) / sizeof(*a))
+
+#ifndef __NR_cachestat
+#define __NR_cachestat    451         /* Same number on all architectures      */
+#endif
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+typedef struct
+{
+  const char* name;   /* name of advice for command line  */
+  int         advice; /* POSIX_FADV_XXX value             */
+} CL_ADVICE;
+
+/* Layout of cachestat(2) arguments, not yet in all headers */
+typedef struct
+{
+  unsigned long long off;
+  unsigned long long len;
+} CL_CSTAT_RANGE;
+
+typedef struct
+{
+  unsigned long long nr_cache;
+  unsigned long long nr_dirty;
+  unsigned long long nr_writeback;
+  unsigned long long nr_evicted;
+  unsigned long long nr_recently_evicted;
+} CL_CSTAT;
+
+typedef struct
+{
+  const char* path;   /* file name                                   */
+  int         fd;     /* opened file                                 */
+  off_t       size;   /* file size in bytes                          */
+  char*       map;    /* mapping of whole file in mmap mode or NULL  */
+} CL_FILE;
+
+typedef struct
+{
+  unsigned    rate;     /* MB/s to stream or 0 for unlimited          */
+  int         use_mmap; /* access files using mmap instead of read    */
+  int         one_pass; /* exit after scanning all files once         */
+  int         advice;   /* -1 or POSIX_FADV_XXX to apply              */
+  unsigned    create;   /* MB to create every file with or 0          */
+  unsigned    report;   /* residency report period in seconds         */
+} CL_OPTS;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static const CL_ADVICE advices[] =
+{
+  { "normal",     POSIX_FADV_NORMAL     },
+  { "sequential", POSIX_FADV_SEQUENTIAL },
+  { "random",     POSIX_FADV_RANDOM     },
+  { "noreuse",    POSIX_FADV_NOREUSE    },
+  { "willneed",   POSIX_FADV_WILLNEED   },
+  { "dontneed",   POSIX_FADV_DONTNEED   }
+};
+
+static CL_OPTS  opts;
+static CL_FILE* files;
+static unsigned nfiles;
+static unsigned pagesize;
+static volatile int done_flag;
+static struct timespec epoch;
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * cl_elapsed -- seconds since start of the run.
+ * parameters: nothing
+ * returns: elapsed seconds.
+ * ------------------------------------------------------------------------- */
+
+static double cl_elapsed(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - epoch.tv_sec) + (now.tv_nsec - epoch.tv_nsec) / 1e9;
+} /* cl_elapsed */
+
+/* ------------------------------------------------------------------------- *
+ * cl_sleep_until -- sleep until the given moment since start of the run.
+ * parameters: seconds since epoch
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void cl_sleep_until(double moment)
+{
+  struct timespec wake = epoch;
+  long long nsec = (long long)(moment * 1e9) + wake.tv_nsec;
+
+  wake.tv_sec  += nsec / 1000000000LL;
+  wake.tv_nsec  = nsec % 1000000000LL;
+  while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) && !done_flag)
+    ;
+} /* cl_sleep_until */
+
+/* ------------------------------------------------------------------------- *
+ * cl_getadvice -- returns advice by name.
+ * parameters: name
+ * returns: POSIX_FADV_XXX value or -1 if not known.
+ * ------------------------------------------------------------------------- */
+
+static int cl_getadvice(const char* name)
+{
+  unsigned index;
+
+  for (index = 0; index < CL_CAPACITY(advices); index++)
+    if (0 == strcmp(advices[index].name, name))
+      return advices[index].advice;
+
+  return -1;
+} /* cl_getadvice */
+
+/* ------------------------------------------------------------------------- *
+ * cl_resident -- count resident pages of the file.
+ * parameters: file, pointer to evicted pages counter (may stay untouched)
+ * returns: number of resident pages.
+ * ------------------------------------------------------------------------- */
+
+static unsigned long long cl_resident(const CL_FILE* file, unsigned long long* evicted)
+{
+  static int use_mincore = 0;
+  unsigned long long resident = 0;
+  const size_t pages = (file->size + pagesize - 1) / pagesize;
+  unsigned char* vec;
+  void* map;
+  size_t index;
+
+  if (!use_mincore)
+  {
+    CL_CSTAT_RANGE range = { 0, 0 };   /* zero length means up to end of file */
+    CL_CSTAT cs;
+
+    if (0 == syscall(__NR_cachestat, file->fd, &range, &cs, 0))
+    {
+      *evicted += cs.nr_evicted;
+      return cs.nr_cache;
+    }
+    use_mincore = 1;
+  }
+
+  if (0 == pages)
+    return 0;
+
+  map = (file->map ? file->map : mmap(NULL, file->size, PROT_READ, MAP_SHARED, file->fd, 0));
+  if (MAP_FAILED == map)
+    return 0;
+
+  vec = (unsigned char*)malloc(pages);
+  if (vec && 0 == mincore(map, file->size, vec))
+  {
+    for (index = 0; index < pages; index++)
+      resident += (vec[index] & 1);
+  }
+  free(vec);
+
+  if (map != file->map)
+    munmap(map, file->size);
+
+  return resident;
+} /* cl_resident */
+
+/* ------------------------------------------------------------------------- *
+ * cl_report -- report page cache residency of all files.
+ * parameters: bytes streamed so far
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void cl_report(unsigned long long streamed)
+{
+  unsigned long long resident = 0;
+  unsigned long long evicted  = 0;
+  unsigned long long total    = 0;
+  const double       elapsed  = cl_elapsed();
+  unsigned index;
+
+  for (index = 0; index < nfiles; index++)
+  {
+    resident += cl_resident(files + index, &evicted);
+    total    += files[index].size;
+  }
+
+  printf ("%8.1f s: streamed %llu MB (%.1f MB/s), resident %llu of %llu MB (%.1f%%)",
+          elapsed, streamed >> 20, (elapsed > 0 ? (streamed >> 20) / elapsed : 0.0),
+          (resident * pagesize) >> 20, total >> 20,
+          (total ? 100.0 * resident * pagesize / total : 0.0));
+  if (evicted)
+    printf (", evicted %llu MB", (evicted * pagesize) >> 20);
+  printf ("\n");
+  fflush(stdout);
+} /* cl_report */
+
+/* ------------------------------------------------------------------------- *
+ * cl_create -- extend the file to required size with non-zero data.
+ * parameters: file name, size in MB
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int cl_create(const char* path, unsigned size)
+{
+  struct stat st;
+  char*  chunk;
+  off_t  offset;
+  int    fd = open(path, O_WRONLY | O_CREAT, 0644);
+
+  if (fd < 0 || fstat(fd, &st) < 0)
+  {
+    printf ("cannot create %s: %s\n", path, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+
+  chunk = (char*)malloc(CL_CHUNK);
+  if (NULL == chunk)
+  {
+    close(fd);
+    return -1;
+  }
+  memset(chunk, 0x55, CL_CHUNK);
+
+  for (offset = st.st_size; offset < ((off_t)size << 20); offset += CL_CHUNK)
+  {
+    if (CL_CHUNK != pwrite(fd, chunk, CL_CHUNK, offset))
+    {
+      printf ("cannot write %s: %s\n", path, strerror(errno));
+      break;
+    }
+  }
+
+  free(chunk);
+  /* leave only clean pages in the cache, the load is about reading */
+  fdatasync(fd);
+  close(fd);
+
+  return (offset < ((off_t)size << 20) ? -1 : 0);
+} /* cl_create */
+
+/* ------------------------------------------------------------------------- *
+ * cl_open -- open and optionally map the file.
+ * parameters: file, path
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int cl_open(CL_FILE* file, const char* path)
+{
+  struct stat st;
+
+  memset(file, 0, sizeof(*file));
+  file->path = path;
+  file->fd   = open(path, O_RDONLY);
+  if (file->fd < 0 || fstat(file->fd, &st) < 0)
+  {
+    printf ("cannot open %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  file->size = st.st_size;
+
+  if (opts.use_mmap && file->size)
+  {
+    file->map = (char*)mmap(NULL, file->size, PROT_READ, MAP_SHARED, file->fd, 0);
+    if (MAP_FAILED == (void*)file->map)
+    {
+      printf ("cannot map %s: %s\n", path, strerror(errno));
+      return -1;
+    }
+  }
+
+  if (opts.advice >= 0 && POSIX_FADV_DONTNEED != opts.advice && POSIX_FADV_WILLNEED != opts.advice)
+  {
+    posix_fadvise(file->fd, 0, 0, opts.advice);
+    if (file->map && POSIX_FADV_NORMAL != opts.advice)
+      madvise(file->map, file->size, (POSIX_FADV_RANDOM == opts.advice ? MADV_RANDOM : MADV_SEQUENTIAL));
+  }
+
+  printf ("%s: %llu MB\n", path, (unsigned long long)file->size >> 20);
+  return 0;
+} /* cl_open */
+
+/* ------------------------------------------------------------------------- *
+ * cl_stream -- read or touch one chunk of the file.
+ * parameters: file, offset, buffer for read mode
+ * returns: bytes streamed.
+ * ------------------------------------------------------------------------- */
+
+static size_t cl_stream(CL_FILE* file, off_t offset, char* buffer)
+{
+  size_t length = CL_CHUNK;
+
+  if (offset + (off_t)length > file->size)
+    length = file->size - offset;
+
+  if (file->map)
+  {
+    static volatile char sink;
+    size_t index;
+
+    for (index = 0; index < length; index += pagesize)
+      sink += file->map[offset + index];
+  }
+  else
+  {
+    const ssize_t got = pread(file->fd, buffer, length, offset);
+    length = (got > 0 ? (size_t)got : 0);
+  }
+
+  /* drop-behind variant, pages just streamed leave the cache */
+  if (POSIX_FADV_DONTNEED == opts.advice)
+  {
+    /* mapped pages are not dropped, so unmap them from page tables first */
+    if (file->map)
+      madvise(file->map + offset, length, MADV_DONTNEED);
+    posix_fadvise(file->fd, offset, length, POSIX_FADV_DONTNEED);
+  }
+
+  return length;
+} /* cl_stream */
+
+/* ------------------------------------------------------------------------- *
+ * cl_done_handler -- handler for termination signal.
+ * parameters: signal received
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void cl_done_handler(int signo)
+{
+  /* Make compiler happy */
+  signo = signo;
+  done_flag = 1;
+} /* cl_done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * cl_usage -- show usage of application
+ * parameters: application name
+ * returns: 1.
+ * ------------------------------------------------------------------------- */
+
+static int cl_usage(const char* self)
+{
+  unsigned index;
+
+  printf ("\nUsage: %s [-s <MB>] [-r <MB/s>] [-m] [-1] [-a <advice>] [-i <secs>] file...\n", self);
+  printf ("\nOptions:\n");
+  printf ("  -s\t\tcreate or extend every file to the given size first.\n");
+  printf ("  -r\t\tstream files at the given rate, default is unlimited.\n");
+  printf ("  -m\t\taccess files using mmap instead of buffered read.\n");
+  printf ("  -1\t\tscan the files once and exit, default is to repeat.\n");
+  printf ("  -a\t\tposix_fadvise to use:");
+  for (index = 0; index < CL_CAPACITY(advices); index++)
+    printf (" %s", advices[index].name);
+  printf (".\n");
+  printf ("  \t\t'willneed' is given before every pass, 'dontneed' after every chunk.\n");
+  printf ("  -i\t\tpage cache residency report period, default %u seconds.\n", CL_REPORT);
+  printf ("\nExample:\n");
+  printf ("  %s -s 512 -r 50 /tmp/c1 /tmp/c2\n", self);
+  printf ("  %s -1 -m -a dontneed big.img\n", self);
+  printf ("\n");
+  return 1;
+} /* cl_usage */
+
+/* ========================================================================= *
+ * Main function.
+ * ========================================================================= */
+
+int main(int argc, char* const argv[])
+{
+  unsigned long long streamed = 0;
+  unsigned pass;
+  unsigned index;
+  double   next_report;
+  char*    buffer;
+  int      c;
+
+  printf ("page cache pressure generator, build %s %s\n", __DATE__, __TIME__);
+
+  memset(&opts, 0, sizeof(opts));
+  opts.advice = -1;
+  opts.report = CL_REPORT;
+  pagesize    = (unsigned)getpagesize();
+
+  opterr = 0;
+  while ((c = getopt(argc, argv, "s:r:m1a:i:")) != -1)
+  {
+    switch (c)
+    {
+      case 's':
+        opts.create = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        opts.rate = strtoul(optarg, NULL, 0);
+        break;
+      case 'm':
+        opts.use_mmap = 1;
+        break;
+      case '1':
+        opts.one_pass = 1;
+        break;
+      case 'a':
+        opts.advice = cl_getadvice(optarg);
+        if (opts.advice < 0)
+          return cl_usage(argv[0]);
+        break;
+      case 'i':
+        opts.report = strtoul(optarg, NULL, 0);
+        if (0 == opts.report)
+          return cl_usage(argv[0]);
+        break;
+      default:
+        return cl_usage(argv[0]);
+    }
+  }
+
+  if (optind >= argc)
+    return cl_usage(argv[0]);
+
+  nfiles = argc - optind;
+  files  = (CL_FILE*)calloc(nfiles, sizeof(*files));
+  buffer = (char*)malloc(CL_CHUNK);
+  if (NULL == files || NULL == buffer)
+  {
+    printf ("no memory available\n");
+    return 1;
+  }
+
+  for (index = 0; index < nfiles; index++)
+  {
+    if (opts.create && cl_create(argv[optind + index], opts.create) < 0)
+      return 1;
+    if (cl_open(files + index, argv[optind + index]) < 0)
+      return 1;
+  }
+
+  printf ("streaming %u files %s using %s", nfiles, (opts.one_pass ? "once" : "repeatedly"),
+          (opts.use_mmap ? "mmap" : "read"));
+  if (opts.rate)
+    printf (" at %u MB/s", opts.rate);
+  printf ("\n");
+
+  signal(SIGINT,  cl_done_handler);
+  signal(SIGTERM, cl_done_handler);
+  clock_gettime(CLOCK_MONOTONIC, &epoch);
+  cl_report(0);
+  next_report = opts.report;
+
+  for (pass = 1; !done_flag; pass++)
+  {
+    for (index = 0; index < nfiles && !done_flag; index++)
+    {
+      CL_FILE* file = files + index;
+      off_t    offset;
+
+      if (POSIX_FADV_WILLNEED == opts.advice)
+        posix_fadvise(file->fd, 0, 0, POSIX_FADV_WILLNEED);
+
+      for (offset = 0; offset < file->size && !done_flag; offset += CL_CHUNK)
+      {
+        streamed += cl_stream(file, offset, buffer);
+
+        /* keep the rate by sleeping till the moment chunk is due */
+        if (opts.rate)
+          cl_sleep_until((double)streamed / ((double)opts.rate * (1 << 20)));
+
+        if (cl_elapsed() >= next_report)
+        {
+          cl_report(streamed);
+          next_report += opts.report;
+        }
+      }
+    }
+
+    if (opts.one_pass)
+      break;
+    if (!done_flag && 1 == pass)
+      printf ("%8.1f s: first pass completed\n", cl_elapsed());
+  }
+
+  cl_report(streamed);
+  return 0;
+} /* main */
+
+/* ========================================================================= *
+ *                    No more code in file cacheload.c                       *
+ * ========================================================================= */
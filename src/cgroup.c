@@ -0,0 +1,345 @@
+/* ========================================================================= *
+ * File: cgroup.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Limits and pressure events of own cgroup v2, see cgroup.h.
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cgroup.h"
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+#define CG_SELF       "/proc/self/cgroup"
+#define CG_MOUNTINFO  "/proc/self/mountinfo"
+
+typedef struct
+{
+  const char* file;   /* file in cgroup directory  */
+  const char* key;    /* key of flat keyed file    */
+} CG_DESC;
+
+static const CG_DESC cg_desc[CG_COUNT] =
+{
+  { "cpu.stat",      "nr_periods"     },
+  { "cpu.stat",      "nr_throttled"   },
+  { "cpu.stat",      "throttled_usec" },
+  { "memory.events", "high"           },
+  { "memory.events", "max"            },
+  { "memory.events", "oom"            },
+  { "memory.events", "oom_kill"       }
+};
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * cg_key -- read value of key from flat keyed file like cpu.stat.
+ * parameters: directory, file name, key, value to fill
+ * returns: 0 if found, -1 if not.
+ * ------------------------------------------------------------------------- */
+
+static int cg_key(const char* dir, const char* file, const char* key, unsigned long long* value)
+{
+  char  path[640];
+  char  line[128];
+  FILE* fp;
+  int   result = -1;
+  const size_t len = strlen(key);
+
+  snprintf(path, sizeof(path), "%s/%s", dir, file);
+  fp = fopen(path, "r");
+  if (NULL == fp)
+    return -1;
+
+  while (fgets(line, sizeof(line), fp))
+  {
+    if (0 == strncmp(line, key, len) && ' ' == line[len])
+    {
+      *value = strtoull(line + len + 1, NULL, 10);
+      result = 0;
+      break;
+    }
+  }
+
+  fclose(fp);
+  return result;
+} /* cg_key */
+
+/* ------------------------------------------------------------------------- *
+ * cg_line -- read first line of file in cgroup directory.
+ * parameters: directory, file name, buffer and its size
+ * returns: 0 if read, -1 if not.
+ * ------------------------------------------------------------------------- */
+
+static int cg_line(const char* dir, const char* file, char* line, size_t size)
+{
+  char  path[640];
+  FILE* fp;
+  int   result = -1;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, file);
+  fp = fopen(path, "r");
+  if (fp)
+  {
+    if (fgets(line, size, fp))
+      result = 0;
+    fclose(fp);
+  }
+
+  return result;
+} /* cg_line */
+
+/* ------------------------------------------------------------------------- *
+ * cg_parent -- cut the last component of cgroup directory.
+ * parameters: directory to cut, length of cgroup2 mount point
+ * returns: 0 if parent is still inside of the mount, -1 if not.
+ * ------------------------------------------------------------------------- */
+
+static int cg_parent(char* dir, size_t mount)
+{
+  char* slash = strrchr(dir, '/');
+
+  if (NULL == slash || (size_t)(slash - dir) < mount)
+    return -1;
+
+  *slash = 0;
+  return 0;
+} /* cg_parent */
+
+/* ------------------------------------------------------------------------- *
+ * cg_mount -- find where cgroup2 is mounted.
+ * parameters: mount point to fill, its root to fill, buffer sizes
+ * returns: 0 if found, -1 if not.
+ * ------------------------------------------------------------------------- */
+
+static int cg_mount(char* point, char* root, size_t size)
+{
+  FILE* fp = fopen(CG_MOUNTINFO, "r");
+  char  line[1024];
+  int   result = -1;
+
+  if (NULL == fp)
+    return -1;
+
+  /* id parent major:minor root point options [tags] - type source options */
+  while (result < 0 && fgets(line, sizeof(line), fp))
+  {
+    char  mroot[256];
+    char  mpoint[256];
+    char* tail = strstr(line, " - ");
+
+    if (tail && 0 == strncmp(tail, " - cgroup2 ", 11) &&
+        2 == sscanf(line, "%*s %*s %*s %255s %255s", mroot, mpoint))
+    {
+      snprintf(point, size, "%s", mpoint);
+      snprintf(root,  size, "%s", mroot);
+      result = 0;
+    }
+  }
+
+  fclose(fp);
+  return result;
+} /* cg_mount */
+
+/* ========================================================================= *
+ * Public methods.
+ * ========================================================================= */
+
+int cg_open(CG_SET* set)
+{
+  char  point[256];
+  char  root[256];
+  char  line[256];
+  FILE* fp;
+  const char* path = NULL;
+
+  memset(set, 0, sizeof(*set));
+  if (cg_mount(point, root, sizeof(point)) < 0)
+    return -1;
+
+  /* unified hierarchy is the line with id 0 and no controllers */
+  fp = fopen(CG_SELF, "r");
+  if (NULL == fp)
+    return -1;
+  while (NULL == path && fgets(line, sizeof(line), fp))
+  {
+    if (0 == strncmp(line, "0::", 3))
+    {
+      line[strcspn(line, "\n")] = 0;
+      path = line + 3;
+    }
+  }
+  fclose(fp);
+  if (NULL == path)
+    return -1;
+
+  /* bind mount of a subtree, e.g. in containers without cgroup namespace */
+  if (strcmp(root, "/") && 0 == strncmp(path, root, strlen(root)))
+    path += strlen(root);
+  if (0 == strcmp(path, "/"))
+    path = "";
+
+  snprintf(set->path, sizeof(set->path), "%s%s", point, path);
+  set->mount = strlen(point);
+  if (access(set->path, R_OK) < 0)
+  {
+    memset(set, 0, sizeof(*set));
+    return -1;
+  }
+
+  cg_sample(set);
+  memcpy(set->start, set->last, sizeof(set->start));
+  memset(set->delta, 0, sizeof(set->delta));
+  return 0;
+} /* cg_open */
+
+double cg_cpu_limit(const CG_SET* set)
+{
+  char   dir[sizeof(set->path)];
+  char   line[64];
+  double cpus = 0;
+
+  if (0 == set->path[0])
+    return 0;
+
+  /* cpu.max is "max 100000" or "<quota> <period>" in every non-root level */
+  snprintf(dir, sizeof(dir), "%s", set->path);
+  do
+  {
+    unsigned long long quota;
+    unsigned long long period;
+
+    if (0 == cg_line(dir, "cpu.max", line, sizeof(line)) &&
+        2 == sscanf(line, "%llu %llu", &quota, &period) && period)
+    {
+      if (0 == cpus || (double)quota / period < cpus)
+        cpus = (double)quota / period;
+    }
+  } while (0 == cg_parent(dir, set->mount));
+
+  return cpus;
+} /* cg_cpu_limit */
+
+unsigned long long cg_memory_limit(const CG_SET* set)
+{
+  char   dir[sizeof(set->path)];
+  char   line[64];
+  unsigned long long limit = 0;
+
+  if (0 == set->path[0])
+    return 0;
+
+  snprintf(dir, sizeof(dir), "%s", set->path);
+  do
+  {
+    unsigned long long value;
+
+    if (0 == cg_line(dir, "memory.max", line, sizeof(line)) && 1 == sscanf(line, "%llu", &value))
+    {
+      if (0 == limit || value < limit)
+        limit = value;
+    }
+  } while (0 == cg_parent(dir, set->mount));
+
+  return limit;
+} /* cg_memory_limit */
+
+unsigned long long cg_memory_available(const CG_SET* set)
+{
+  char   dir[sizeof(set->path)];
+  char   line[64];
+  unsigned long long available = ~0ULL;
+
+  if (0 == set->path[0])
+    return available;
+
+  /* the same as free + buffers + cached of /proc/meminfo on every level */
+  snprintf(dir, sizeof(dir), "%s", set->path);
+  do
+  {
+    unsigned long long limit;
+    unsigned long long current;
+    unsigned long long file = 0;
+
+    if (0 == cg_line(dir, "memory.max", line, sizeof(line)) && 1 == sscanf(line, "%llu", &limit) &&
+        0 == cg_line(dir, "memory.current", line, sizeof(line)) && 1 == sscanf(line, "%llu", &current))
+    {
+      cg_key(dir, "memory.stat", "file", &file);
+      current = (file < current ? current - file : 0);
+      limit   = (current < limit ? limit - current : 0);
+      if (limit < available)
+        available = limit;
+    }
+  } while (0 == cg_parent(dir, set->mount));
+
+  return available;
+} /* cg_memory_available */
+
+void cg_sample(CG_SET* set)
+{
+  unsigned index;
+
+  if (0 == set->path[0])
+    return;
+
+  for (index = 0; index < CG_COUNT; index++)
+  {
+    unsigned long long value;
+
+    if (0 == cg_key(set->path, cg_desc[index].file, cg_desc[index].key, &value))
+    {
+      set->delta[index] = value - set->last[index];
+      set->last[index]  = value;
+    }
+  }
+} /* cg_sample */
+
+void cg_print(const CG_SET* set, const char* prefix, int total)
+{
+  unsigned long long values[CG_COUNT];
+  unsigned index;
+
+  if (0 == set->path[0])
+    return;
+
+  for (index = 0; index < CG_COUNT; index++)
+    values[index] = (total ? set->last[index] - set->start[index] : set->delta[index]);
+
+  printf ("%s cgroup throttled %llu of %llu periods for %.1f ms, memory events high %llu max %llu oom %llu oom_kill %llu\n",
+          prefix, values[CG_THROTTLED], values[CG_PERIODS], values[CG_THROTTLED_USEC] / 1000.0,
+          values[CG_HIGH], values[CG_MAX], values[CG_OOM], values[CG_OOM_KILL]);
+} /* cg_print */
+
+/* ========================================================================= *
+ *                    No more code in file cgroup.c                          *
+ * ========================================================================= */
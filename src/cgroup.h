@@ -0,0 +1,70 @@
+/* ========================================================================= *
+ * File: cgroup.h
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Limits and pressure events of the cgroup v2 the process runs in, so
+ *    that load targets can be taken relative to a container quota instead
+ *    of the whole machine. Limits are the tightest ones of the cgroup and
+ *    its ancestors. Without cgroup v2 everything is reported as unlimited.
+ * ========================================================================= */
+
+#ifndef CGROUP_H
+#define CGROUP_H
+
+typedef enum
+{
+  CG_PERIODS,         /* cpu.stat nr_periods                 */
+  CG_THROTTLED,       /* cpu.stat nr_throttled               */
+  CG_THROTTLED_USEC,  /* cpu.stat throttled_usec             */
+  CG_HIGH,            /* memory.events high                  */
+  CG_MAX,             /* memory.events max                   */
+  CG_OOM,             /* memory.events oom                   */
+  CG_OOM_KILL,        /* memory.events oom_kill              */
+  CG_COUNT
+} CG_STAT;
+
+typedef struct
+{
+  char               path[512];         /* cgroup directory, empty if none  */
+  unsigned           mount;             /* length of cgroup2 mount point    */
+  unsigned long long start[CG_COUNT];   /* values at cg_open                */
+  unsigned long long last[CG_COUNT];    /* values at previous sample        */
+  unsigned long long delta[CG_COUNT];   /* difference since previous sample */
+} CG_SET;
+
+/* Finds own cgroup v2 directory, returns 0 if found and -1 if not */
+int  cg_open(CG_SET* set);
+
+/* CPUs allowed by cpu.max, 0 if not limited */
+double cg_cpu_limit(const CG_SET* set);
+
+/* Bytes allowed by memory.max, 0 if not limited */
+unsigned long long cg_memory_limit(const CG_SET* set);
+
+/* Bytes which can be allocated before reaching memory.max when page cache
+   is reclaimed, ~0 if not limited */
+unsigned long long cg_memory_available(const CG_SET* set);
+
+/* Reads statistics and updates deltas since the previous cg_sample call */
+void cg_sample(CG_SET* set);
+
+/* Prints the latest deltas or totals since cg_open as one line */
+void cg_print(const CG_SET* set, const char* prefix, int total);
+
+#endif /* CGROUP_H */
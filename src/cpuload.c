@@ -39,12 +39,15 @@
  * Includes
  * ========================================================================= */
 
-#define _XOPEN_SOURCE 500
+#define _GNU_SOURCE
 
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <linux/sched.h>
 #include <sched.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -53,6 +56,13 @@
 #include <errno.h>
 #include <ctype.h>
 
+#include "cgroup.h"
+#include "ctlsock.h"
+#include "cputelem.h"
+#include "lathist.h"
+#include "perfctr.h"
+#include "schedopt.h"
+
 #define FALSE 0
 #define TRUE 1
 
@@ -62,6 +72,7 @@
 
 #define  CALIBRATION_SLICE    1.0   /* load slice value for calibration and load */
 #define  CALIBRATION_PERIOD   5     /* seconds is minimal acceptable period      */
+#define  PROBE_INTERVAL       1000  /* default latency probe period, microseconds */
 typedef unsigned long long LOOPS;
 
 /* ========================================================================= *
@@ -70,6 +81,37 @@ typedef unsigned long long LOOPS;
 
 static double s_slice = CALIBRATION_SLICE;
 static LOOPS  s_loops = 0;   /* Number of empty loops per second that CPU can make */
+static int    s_counters = FALSE;  /* Report performance counters per interval */
+static volatile int s_done = FALSE; /* Termination requested                    */
+
+/* Load state which can be changed through control socket */
+static unsigned s_load = 0;         /* Current load target in percents          */
+static int      s_paused = FALSE;   /* Only idle slices are done when paused    */
+static int      s_retarget = FALSE; /* Current interval shall be restarted      */
+static unsigned s_interval = 0;     /* Number of the current interval           */
+static LOOPS    s_busy_slices = 0;  /* Busy slices done since start             */
+static LOOPS    s_all_slices = 0;   /* All slices done since start              */
+static const char* s_control = NULL;/* Control socket path or NULL              */
+
+/* Scheduler latency probe settings and results */
+static unsigned s_probes = 0;       /* Number of probe threads, 0 if disabled   */
+static unsigned s_probe_interval = PROBE_INTERVAL;
+static char     s_probe_id = 'o';   /* Probe policy as given to '-q'            */
+static int      s_probe_prio = -1;  /* Probe priority or -1 for the maximum     */
+static char     s_load_id = 'o';    /* Load policy as given to '-s'             */
+static pthread_mutex_t s_probe_lock = PTHREAD_MUTEX_INITIALIZER;
+static LH_HIST  s_probe_hist;       /* Wakeup latencies of the current interval */
+static LH_HIST  s_probe_total;      /* Wakeup latencies of the whole run        */
+
+/* Frequency, throttling and energy telemetry */
+static unsigned s_telemetry = 0;    /* Telemetry period in seconds, 0 disabled  */
+static CT_SET   s_ct;               /* Telemetry sources and latest sample      */
+static LH_NSEC  s_busy_ns = 0;      /* Time spent in busy slices since start    */
+
+/* cgroup v2 limits, load is relative to cpu.max quota */
+static CG_SET   s_cgroup;           /* Own cgroup, empty path if not found      */
+static double   s_quota = 0;        /* CPUs allowed by cpu.max, 0 if unlimited  */
+static double   s_share = 1.0;      /* Part of one CPU the quota gives          */
 
 /* ========================================================================= *
  * Methods.
@@ -89,6 +131,23 @@ static void cpu_load_slice(void)
 } /* cpu_load_slice */
 
 
+/* ------------------------------------------------------------------------- *
+ * calibration_time -- Clock used for calibration. Under cgroup CPU quota
+ *    the time the thread is throttled would be taken as slower CPU, so
+ *    thread CPU time is used instead of wall clock.
+ * parameters: nothing.
+ * returns: seconds.
+ * ------------------------------------------------------------------------- */
+
+static time_t calibration_time(void)
+{
+   struct timespec ts;
+
+   if ( 0 == s_quota || clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0 )
+      return time(NULL);
+   return ts.tv_sec;
+} /* calibration_time */
+
 /* ------------------------------------------------------------------------- *
  * calibrate_cpu -- Detects CPU speed and estimate how much busy loops
  *    can we done per second.
@@ -112,13 +171,13 @@ static void calibrate_cpu(void)
       {
          LOOPS loop = 0;
 
-         period = time(NULL);
+         period = calibration_time();
          while (loop < loops)
          {
             cpu_load_slice();
             loop++;
          }
-         period = time(NULL) - period;
+         period = calibration_time() - period;
 
          if (period >= CALIBRATION_PERIOD)
             break;
@@ -138,10 +197,187 @@ static void calibrate_cpu(void)
    printf (" %llu loops per second\n", s_loops);
 } /* calibrate_cpu */
 
+/* ------------------------------------------------------------------------- *
+ * probe_setup -- Applies probe scheduling policy to the calling thread.
+ * parameters: nothing.
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void probe_setup(void)
+{
+   so_apply(s_probe_id, s_probe_prio, "probe");
+} /* probe_setup */
+
+/* ------------------------------------------------------------------------- *
+ * probe_thread -- Wakes up on absolute deadlines and records how late the
+ *    wakeup happened, similar to cyclictest.
+ * parameters: unused.
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* probe_thread(void* arg)
+{
+   const LH_NSEC period = s_probe_interval * 1000ULL;
+   LH_NSEC deadline;
+
+   probe_setup();
+
+   deadline = lh_now();
+   while (!s_done)
+   {
+      struct timespec wake;
+      LH_NSEC late;
+
+      deadline += period;
+      wake.tv_sec  = deadline / 1000000000ULL;
+      wake.tv_nsec = deadline % 1000000000ULL;
+      while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL))
+         ;
+      late = lh_now() - deadline;
+
+      pthread_mutex_lock(&s_probe_lock);
+      lh_add(&s_probe_hist, late);
+      pthread_mutex_unlock(&s_probe_lock);
+   }
+
+   return arg;
+} /* probe_thread */
+
+/* ------------------------------------------------------------------------- *
+ * probe_report -- Prints wakeup latencies of the interval and resets them.
+ * parameters: interval number.
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void probe_report(unsigned interval)
+{
+   char prefix[48];
+
+   pthread_mutex_lock(&s_probe_lock);
+   lh_merge(&s_probe_total, &s_probe_hist);
+   snprintf(prefix, sizeof(prefix), "interval %u: wakeup latency", interval);
+   lh_print(&s_probe_hist, prefix);
+   lh_init(&s_probe_hist);
+   pthread_mutex_unlock(&s_probe_lock);
+} /* probe_report */
+
+/* ------------------------------------------------------------------------- *
+ * telemetry_report -- Prints frequency, throttling and energy of the period
+ *    together with work done, and how fast busy slices ran compared to the
+ *    calibration, e.g. 80% means CPU was throttled or its clock capped.
+ * parameters: interval number, loops in one busy slice.
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void telemetry_report(unsigned interval, LOOPS slice)
+{
+   static LOOPS   last_slices = 0;
+   static LH_NSEC last_ns = 0;
+   const LOOPS    busy = s_busy_slices - last_slices;
+   const LH_NSEC  ns = s_busy_ns - last_ns;
+   char prefix[64];
+
+   ct_sample(&s_ct);
+   if ( ns )
+      snprintf(prefix, sizeof(prefix), "\rinterval %u: busy speed %.1f%% of calibrated,",
+               interval, 100.0 * busy * slice / (ns / 1e9) / s_loops);
+   else
+      snprintf(prefix, sizeof(prefix), "\rinterval %u: busy speed n/a,", interval);
+   ct_print(&s_ct, prefix, busy * slice);
+   if ( s_cgroup.path[0] )
+   {
+      snprintf(prefix, sizeof(prefix), "interval %u:", interval);
+      cg_sample(&s_cgroup);
+      cg_print(&s_cgroup, prefix, FALSE);
+   }
+
+   last_slices = s_busy_slices;
+   last_ns = s_busy_ns;
+} /* telemetry_report */
+
+/* ------------------------------------------------------------------------- *
+ * done_handler -- Handler for termination signals.
+ * parameters: signal received.
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void done_handler(int signo)
+{
+   (void)signo;
+   s_done = TRUE;
+} /* done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * control_handler -- Handles one command from the control socket.
+ * parameters: command line, reply buffer and its size.
+ * returns: nothing (reply is filled).
+ * ------------------------------------------------------------------------- */
+
+static void control_handler(const char* command, char* reply, size_t size)
+{
+   unsigned load;
+   char     tail;
+
+   if (1 == sscanf(command, " set load %u %c", &load, &tail))
+   {
+      if (load > 100)
+         snprintf(reply, size, "error: illegal load value %u", load);
+      else if (('f' == s_load_id || 'r' == s_load_id) && (0 == load || load > 90))
+         snprintf(reply, size, "error: unsuitable %u load (random or >90) for real-time scheduling", load);
+      else
+      {
+         s_load = load;
+         s_retarget = TRUE;
+         snprintf(reply, size, "ok");
+      }
+   }
+   else if (0 == strcmp(command, "pause"))
+   {
+      s_paused = TRUE;
+      s_retarget = TRUE;
+      snprintf(reply, size, "ok");
+   }
+   else if (0 == strcmp(command, "resume"))
+   {
+      s_paused = FALSE;
+      s_retarget = TRUE;
+      snprintf(reply, size, "ok");
+   }
+   else if (0 == strcmp(command, "stats"))
+   {
+      snprintf(reply, size, "load %u paused %d policy %c interval %u loops %llu busy %.1f%%",
+               s_load, s_paused, s_load_id, s_interval, s_loops,
+               (s_all_slices ? 100.0 * s_busy_slices / s_all_slices : 0.0));
+   }
+   else
+      snprintf(reply, size, "error: unknown command, use 'set load <0-100>', 'pause', 'resume' or 'stats'");
+} /* control_handler */
+
+/* ------------------------------------------------------------------------- *
+ * idle_slice -- Sleeps for 10 ms, handling control commands meanwhile.
+ * parameters: nothing.
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void idle_slice(void)
+{
+   const LH_NSEC deadline = lh_now() + 10 * 1000 * 1000;
+   LH_NSEC now;
+
+   if ( !cs_active() )
+   {
+      usleep(10 * 1000);
+      return;
+   }
+
+   while ((now = lh_now()) < deadline && !s_done)
+      cs_poll((int)((deadline - now + 999999) / 1000000));
+} /* idle_slice */
+
 /* ------------------------------------------------------------------------- *
  * generate_load -- Generates CPU load by using busy loops and usleep moments.
  * parameters: approximate load in percents.
- * returns: nothing (never returns).
+ * returns: nothing (returns only when terminated).
  * ------------------------------------------------------------------------- */
 
 static void generate_load(unsigned load)
@@ -149,150 +385,231 @@ static void generate_load(unsigned load)
    const LOOPS slice = s_loops / 100;
    static const char show[] = "-\\|/";
    unsigned stage = 0;
+   unsigned index;
+   PC_SET   counters;
+   pthread_t* probes = NULL;
+   LH_NSEC  sampled = lh_now();
+
+   if ( s_counters && !pc_open(&counters) )
+      s_counters = FALSE;
+
+   signal(SIGINT,  done_handler);
+   signal(SIGTERM, done_handler);
+
+   s_load = load;
+   if ( s_control && cs_open(s_control, control_handler) < 0 )
+      return;
+
+   if ( s_probes )
+   {
+      lh_init(&s_probe_hist);
+      lh_init(&s_probe_total);
+      probes = (pthread_t*)calloc(s_probes, sizeof(*probes));
+      for (index = 0; probes && index < s_probes; index++)
+      {
+         if ( pthread_create(probes + index, NULL, probe_thread, NULL) )
+         {
+            fprintf(stderr, "\nWARNING: only %u latency probes started.\n", index);
+            break;
+         }
+      }
+      s_probes = index;
+      printf ("%u latency probes with policy '%c' wake up every %u us\n",
+              s_probes, s_probe_id, s_probe_interval);
+   }
 
    printf ("generate %u%c cpu load\n", load, '%');
-   while (1)
+   while ( !s_done )
    {
-      unsigned busy = (load ? load : (0 == (random() & 1) ? 100 : 50));
-      unsigned idle = 100 - busy;
+      unsigned busy = (s_load ? s_load : (0 == (random() & 1) ? 100 : 50));
+      unsigned idle;
 
-      printf("\r%c", show[stage]);
-      fflush(stdout);
-      if ( !show[++stage] )
-         stage = 0;
+      /* percents of cpu.max quota, single thread gets at most one CPU */
+      busy = (unsigned)(busy * s_share + 0.5);
+      idle = 100 - busy;
 
-      while (busy || idle)
+      if ( s_paused )
+      {
+         busy = 0;
+         idle = 100;
+      }
+      s_retarget = FALSE;
+
+      if ( s_counters || s_probes )
+      {
+         /* statistics are collected for the previous interval */
+         if ( s_interval++ )
+         {
+            char prefix[32];
+            snprintf(prefix, sizeof(prefix), "interval %u:", s_interval - 1);
+            if ( s_counters )
+            {
+               pc_sample(&counters);
+               pc_print(&counters, prefix);
+            }
+            if ( s_probes )
+               probe_report(s_interval - 1);
+            fflush(stdout);
+         }
+      }
+      else
+      {
+         s_interval++;
+         printf("\r%c", show[stage]);
+         fflush(stdout);
+         if ( !show[++stage] )
+            stage = 0;
+      }
+
+      if ( s_telemetry && lh_now() - sampled >= s_telemetry * 1000000000ULL )
+      {
+         sampled = lh_now();
+         telemetry_report(s_interval - 1, slice);
+         fflush(stdout);
+      }
+
+      /* new target from control socket takes effect from next slice */
+      while ((busy || idle) && !s_done && !s_retarget)
       {
          if ( busy )
          {
             /* try to be produce load for 10 ms */
+            const LH_NSEC started = lh_now();
             LOOPS loop = 0;
             while (loop < slice)
             {
                cpu_load_slice();
                loop++;
             }
+            s_busy_ns += lh_now() - started;
             busy--;
+            s_busy_slices++;
+            s_all_slices++;
+            if ( cs_active() )
+               cs_poll(0);
          }
 
-         if ( idle )
+         if ( idle && !s_retarget )
          {
             /* sleeping for 10 ms */
-            usleep(10 * 1000);
+            idle_slice();
             idle--;
+            s_all_slices++;
          }
       }
    }
-} /* generate_load */
 
-/* ========================================================================= *
- * Set nice value
- * ========================================================================= */
-static int set_nice(int change)
-{
-   /* Nice() may return -1 even if it succeeded,
-    * thus need to check errno
-    */
-   errno = 0;
-   if (nice(change) < 0 && errno != 0)
-     perror ("\nWARNING: setting priority failed: operating with default.\nReason");
-   return TRUE;
-}
+   cs_close();
 
-/* ========================================================================= *
- * Set process scheduler
- * ========================================================================= */
-static int set_sched(int policy, int load)
-{
-   struct sched_param param;
-   
-   if ((policy == SCHED_RR || policy == SCHED_FIFO)
-       && (load == 0 || load > 90))
+   if ( s_probes )
    {
-      fprintf(stderr, "\nERROR: unsuitable %d load (random or >90) selected for real-time scheduling.\n", load);
-      return FALSE;
+      for (index = 0; index < s_probes; index++)
+         pthread_join(probes[index], NULL);
+      lh_merge(&s_probe_total, &s_probe_hist);
+      printf ("\n%u%c load with policy '%c' gives wakeup latency of probes with policy '%c':\n",
+              s_load, '%', s_load_id, s_probe_id);
+      lh_print(&s_probe_total, "total: wakeup latency");
    }
-   
-   memset(&param, 0, sizeof(param));
-   /* use the highest priority for given scheduler policy */
-   param.sched_priority = sched_get_priority_max(policy);
-   if (sched_setscheduler(0, policy, &param) < 0)
-     perror("\nWARNING: setting scheduler failed failed: operating with default.\nReason");
-
-   return TRUE;
-}
+   free(probes);
+   if ( s_cgroup.path[0] )
+   {
+      cg_sample(&s_cgroup);
+      cg_print(&s_cgroup, "\ntotal:", TRUE);
+   }
+   if ( s_telemetry )
+      ct_close(&s_ct);
+} /* generate_load */
 
 /* ========================================================================= *
  *Argument parsing, return FALSE for failure
  * ========================================================================= */
-static int parse_args(int argc, const char* argv[], unsigned *load)
+static int parse_args(int argc, char* const argv[], unsigned *load)
 {
-   char sched_pol;
+   char sched_pol = 0;
    char *endptr;
-   
-   if (argc < 2 || argc > 4)
+   int c;
+
+   opterr = 0;
+   while ((c = getopt(argc, argv, "ps:cP:I:q:S:T:")) != -1)
+   {
+      switch (c)
+      {
+         /* backwards compatibility, nice to highest priority */
+      case 'p':
+         sched_pol = 'h';
+         break;
+         /* not "-s ."? */
+      case 's':
+         if (!optarg[0] || optarg[1])
+           return FALSE;
+         sched_pol = optarg[0];
+         break;
+      case 'c':
+         s_counters = TRUE;
+         break;
+         /* frequency and energy telemetry period */
+      case 'T':
+         s_telemetry = strtoul(optarg, NULL, 0);
+         if (!s_telemetry)
+           return FALSE;
+         break;
+         /* runtime control socket */
+      case 'S':
+         s_control = optarg;
+         break;
+         /* latency probe threads, period and policy */
+      case 'P':
+         s_probes = strtoul(optarg, NULL, 0);
+         break;
+      case 'I':
+         s_probe_interval = strtoul(optarg, NULL, 0);
+         if (!s_probe_interval)
+           return FALSE;
+         break;
+      case 'q':
+         if (so_parse(optarg, &s_probe_id, &s_probe_prio) < 0)
+           return FALSE;
+         break;
+      default:
+         return FALSE;
+      }
+   }
+
+   if (optind != argc - 1)
      return FALSE;
 
    errno = 0;
-   *load = strtoul(argv[argc-1], &endptr, 0);
+   *load = strtoul(argv[optind], &endptr, 0);
    
-   if (argv[argc-1] == endptr || errno != 0 || *load > 100)
+   if (argv[optind] == endptr || errno != 0 || *load > 100)
    {
       printf ("\nIllegal load value given.\n");
       return FALSE;
    }
 
-   if (argc == 2)
+   if (!sched_pol)
      return TRUE;
+   s_load_id = tolower(sched_pol);
 
-   /* backwards compatibility */
-   if (argc == 3)
+   if (so_realtime(s_load_id) && (*load == 0 || *load > 90))
    {
-      /* nice to highest priority? */
-      if (!strncmp(argv[1], "-p", 2))
-	return set_nice(-19);
+      fprintf(stderr, "\nERROR: unsuitable %d load (random or >90) selected for real-time scheduling.\n", *load);
       return FALSE;
    }
-   
-   /* not "-s ."? */
-   sched_pol = argv[2][0];
-   if (argv[1][0] != '-' || argv[1][1] != 's' || argv[1][2]
-       || !sched_pol || argv[2][1])
-     return FALSE;
-
 
-   /* which scheduling policy requested? */
-   switch(tolower(sched_pol))
+   if (so_apply(s_load_id, -1, "load") < 0)
    {
-      /* nice to lowest priority */
-   case 'l':
-      return set_nice(19);
-      /* nice to highest priority */
-   case 'h':
-      return set_nice(-19);
-      /* batch scheduler */
-   case 'b':
-      return set_sched(SCHED_BATCH, *load);
-      /* scheduler that goes over default SCHED_OTHER */
-   case 'f':
-      return set_sched(SCHED_FIFO, *load);
-      /* SCHED_FIFO with round robin policy */
-   case 'r':
-      return set_sched(SCHED_RR, *load);
-      /* default scheduler */
-   case 'o':
-      return set_sched(SCHED_OTHER, *load);
-   default:
       fprintf(stderr, "\nERROR: Unknown scheduling policy / priority '%c'.\n", sched_pol);
       return FALSE;
    }
+   return TRUE;
 }
 
 /* ========================================================================= *
  * Main function of CPU load generator.
  * ========================================================================= */
 
-int main(int argc, const char* argv[])
+int main(int argc, char* argv[])
 {
    const char *name;
    unsigned int load = 0;
@@ -302,7 +619,25 @@ int main(int argc, const char* argv[])
    
    if (parse_args(argc, argv, &load))
    {
+      if (0 == cg_open(&s_cgroup) && (s_quota = cg_cpu_limit(&s_cgroup)) > 0)
+      {
+         s_share = (s_quota < 1.0 ? s_quota : 1.0);
+         if (s_quota > 1.0)
+            printf ("cgroup %s cpu.max allows %.2f CPUs, but cpuload is single threaded: load is relative to one CPU, 100%c is %.0f%c of the quota\n",
+                    s_cgroup.path, s_quota, '%', 100.0 / s_quota, '%');
+         else
+            printf ("cgroup %s cpu.max allows %.2f CPUs, load is relative to %.0f%c of one CPU\n",
+                    s_cgroup.path, s_quota, 100.0 * s_share, '%');
+      }
+      if (s_telemetry)
+         ct_open(&s_ct);
       calibrate_cpu();
+      if (s_telemetry)
+      {
+         /* calibration runs busy all the time */
+         ct_sample(&s_ct);
+         ct_print(&s_ct, "calibration:", (LOOPS)(s_loops * s_ct.period));
+      }
       generate_load(load);
       return 0;
    }
@@ -313,16 +648,30 @@ int main(int argc, const char* argv[])
    else
      name = argv[0];
    /* usage */
-   printf("\nUsage: %s [-s <id>] <highest CPU load>\n"
+   printf("\nUsage: %s [-s <id>] [-c] [-P <probes> [-I <usecs>] [-q <id>[:<prio>]]] [-T <secs>] [-S <socket>] <highest CPU load>\n"
 	  "\nExample: %s -s h 50\n\n", name, name);
    printf("CPU load of 0 means random load, anything else is percentage (1-100).\n"
 	  "\nThe value given to '-s' can be used to set the scheduling priority/policy:\n"
-	  "\tl -- lowest nice() priority\n"
-	  "\th -- highest nice() priority\n"
-	  "\tb -- use SCHED_BATCH scheduler\n"
-	  "\tf -- use SCHED_FIFO scheduler (real time)\n"
-	  "\tr -- use SCHED_RR scheduler (real time)\n"
-	  "\to -- use SCHED_OTHER (default) scheduler\n"
-	  "\nSee \"man sched_setscheduler\" and \"man 2 nice\".\n");
+	  SO_USAGE
+	  "\nSee \"man sched_setscheduler\" and \"man 2 nice\".\n"
+	  "\nOption '-c' reports cycles, instructions, LLC and dTLB misses and page\n"
+	  "faults of every load interval (about one second) using perf_event_open.\n"
+	  "\nOption '-P' starts given number of latency probe threads which wake up\n"
+	  "every '-I' microseconds (default %u) on absolute deadlines and report\n"
+	  "wakeup latency percentiles of every load interval and at exit. Probe\n"
+	  "policy is given to '-q' with the same ids as to '-s', optionally with\n"
+	  "real-time priority (default is the highest one), e.g. \"-q f:50\".\n"
+	  "\nOption '-T' samples CPU frequency (cpufreq and APERF/MPERF from msr),\n"
+	  "thermal throttling counts and RAPL energy every given seconds and prints\n"
+	  "them with busy loop speed relative to calibration, loops/s, loops/J and\n"
+	  "loops/GHz. Sources which are not readable are reported as n/a.\n"
+	  "\nInside cgroup v2 with cpu.max quota the load is relative to the quota\n"
+	  "up to one CPU; with a larger quota it is relative to one CPU, which is\n"
+	  "printed at start together with the share of the quota. Calibration\n"
+	  "uses thread CPU time and throttling and memory events are reported\n"
+	  "with '-T' and at exit.\n"
+	  "\nOption '-S' creates UNIX socket which accepts line commands 'set load <N>',\n"
+	  "'pause', 'resume' and 'stats'; new load is taken within one 10 ms slice.\n",
+	  PROBE_INTERVAL);
    return 1;
 }
@@ -0,0 +1,407 @@
+/* ========================================================================= *
+ * File: cputelem.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    CPU frequency, throttling and energy telemetry, see cputelem.h.
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cputelem.h"
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+#define CT_CPU        "/sys/devices/system/cpu/cpu%u/"
+#define CT_RAPL       "/sys/class/powercap/intel-rapl:%u/"
+#define CT_MSR        "/dev/cpu/%u/msr"
+
+#define CT_MPERF          0xE7   /* IA32_MPERF, counts at nominal frequency */
+#define CT_APERF          0xE8   /* IA32_APERF, counts at actual frequency  */
+#define CT_PLATFORM_INFO  0xCE   /* bits 15:8 are nominal ratio * 100 MHz   */
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * ct_read -- read number from sysfs file.
+ * parameters: printf format of path, number for path
+ * returns: 0 if read, -1 if not available.
+ * ------------------------------------------------------------------------- */
+
+static int ct_read(unsigned long long* value, const char* format, unsigned index)
+{
+  char  path[128];
+  FILE* fp;
+  int   result = -1;
+
+  snprintf(path, sizeof(path), format, index);
+  fp = fopen(path, "r");
+  if (fp)
+  {
+    if (1 == fscanf(fp, "%llu", value))
+      result = 0;
+    fclose(fp);
+  }
+
+  return result;
+} /* ct_read */
+
+/* ------------------------------------------------------------------------- *
+ * ct_package_zone -- check whether RAPL zone is a package one. Others, like
+ *    psys of the whole platform, already include the package energy.
+ * parameters: zone number
+ * returns: 1 if zone exists and is named package-N, 0 if not.
+ * ------------------------------------------------------------------------- */
+
+static int ct_package_zone(unsigned zone)
+{
+  char  path[128];
+  char  name[32] = "";
+  FILE* fp;
+
+  snprintf(path, sizeof(path), CT_RAPL "name", zone);
+  fp = fopen(path, "r");
+  if (fp)
+  {
+    if (1 != fscanf(fp, "%31s", name))
+      name[0] = 0;
+    fclose(fp);
+  }
+
+  return (0 == strncmp(name, "package-", 8));
+} /* ct_package_zone */
+
+/* ------------------------------------------------------------------------- *
+ * ct_msr -- read model specific register.
+ * parameters: msr device descriptor, register, value to fill
+ * returns: 0 if read, -1 if not.
+ * ------------------------------------------------------------------------- */
+
+static int ct_msr(int fd, unsigned reg, unsigned long long* value)
+{
+  return (sizeof(*value) == pread(fd, value, sizeof(*value), reg) ? 0 : -1);
+} /* ct_msr */
+
+/* ------------------------------------------------------------------------- *
+ * ct_now -- monotonic time.
+ * parameters: nothing
+ * returns: seconds.
+ * ------------------------------------------------------------------------- */
+
+static double ct_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+} /* ct_now */
+
+/* ========================================================================= *
+ * Public methods.
+ * ========================================================================= */
+
+int ct_open(CT_SET* set)
+{
+  unsigned long long value;
+  unsigned long long* packages;
+  unsigned npackages = 0;
+  unsigned cpu;
+  unsigned zone;
+  int      found = 0;
+  int      msrs = 0;
+
+  memset(set, 0, sizeof(*set));
+  set->cpus = (unsigned)sysconf(_SC_NPROCESSORS_CONF);
+  if (0 == set->cpus)
+    set->cpus = 1;
+
+  set->msr           = (int*)malloc(set->cpus * sizeof(*set->msr));
+  set->aperf         = (unsigned long long*)calloc(set->cpus, sizeof(*set->aperf));
+  set->mperf         = (unsigned long long*)calloc(set->cpus, sizeof(*set->mperf));
+  set->package_first = (unsigned char*)calloc(set->cpus, 1);
+  packages           = (unsigned long long*)calloc(set->cpus, sizeof(*packages));
+  if (!set->msr || !set->aperf || !set->mperf || !set->package_first || !packages)
+  {
+    free(packages);
+    free(set->msr);
+    free(set->aperf);
+    free(set->mperf);
+    free(set->package_first);
+    memset(set, 0, sizeof(*set));
+    return 0;
+  }
+
+  for (cpu = 0; cpu < set->cpus; cpu++)
+  {
+    char path[64];
+
+    snprintf(path, sizeof(path), CT_MSR, cpu);
+    set->msr[cpu] = open(path, O_RDONLY | O_CLOEXEC);
+    if (set->msr[cpu] >= 0 && ct_msr(set->msr[cpu], CT_MPERF, &value) < 0)
+    {
+      /* AMD and virtual machines may not implement these */
+      close(set->msr[cpu]);
+      set->msr[cpu] = -1;
+    }
+    msrs += (set->msr[cpu] >= 0);
+
+    /* package throttle counters are the same for all its CPUs, which
+       may be numbered alternating between packages */
+    if (0 == ct_read(&value, CT_CPU "topology/physical_package_id", cpu))
+    {
+      unsigned index = 0;
+
+      while (index < npackages && packages[index] != value)
+        index++;
+      if (index == npackages)
+      {
+        packages[npackages++] = value;
+        set->package_first[cpu] = 1;
+      }
+    }
+  }
+  free(packages);
+
+  /* intel_pstate exports the nominal frequency, otherwise ask CPU */
+  if (ct_read(&set->base_khz, CT_CPU "cpufreq/base_frequency", 0) < 0)
+  {
+    set->base_khz = 0;
+    if (set->msr[0] >= 0 && 0 == ct_msr(set->msr[0], CT_PLATFORM_INFO, &value))
+      set->base_khz = ((value >> 8) & 0xFF) * 100000ULL;
+  }
+
+  /* top level zones are numbered from 0, only packages are summed */
+  for (zone = 0; set->zones < CT_ZONES; zone++)
+  {
+    const unsigned index = set->zones;
+
+    if (ct_read(set->zone_last + index, CT_RAPL "energy_uj", zone) < 0)
+      break;
+    if (!ct_package_zone(zone))
+      continue;
+    if (ct_read(set->zone_range + index, CT_RAPL "max_energy_range_uj", zone) < 0)
+      set->zone_range[index] = 0;
+    set->zone[index]       = zone;
+    set->zone_known[index] = 1;
+    set->zones++;
+  }
+
+  ct_sample(set);
+  found += (set->cur_khz || set->min_khz);
+  found += (msrs > 0);
+  found += set->throttle_known;
+  found += (set->zones > 0);
+
+  printf ("cpu telemetry: frequency %s, aperf/mperf %s, throttling %s, energy %s\n",
+          (set->min_khz ? "cpufreq" : "n/a"),
+          (msrs ? "msr" : "n/a"),
+          (set->throttle_known ? "thermal_throttle" : "n/a"),
+          (set->zones ? "powercap" : "n/a"));
+
+  return found;
+} /* ct_open */
+
+void ct_sample(CT_SET* set)
+{
+  const double now = ct_now();
+  unsigned long long sum = 0;
+  unsigned long long core = 0;
+  unsigned long long package = 0;
+  unsigned online = 0;
+  unsigned cpu;
+  unsigned zone;
+
+  set->period   = (set->started ? now - set->started : 0);
+  set->started  = now;
+  set->cpu      = sched_getcpu();
+  set->cur_khz  = 0;
+  set->min_khz  = 0;
+  set->max_khz  = 0;
+  set->avg_khz  = 0;
+  set->ratio    = 0;
+  set->throttle_known = 0;
+  set->joules   = -1;
+
+  for (cpu = 0; cpu < set->cpus; cpu++)
+  {
+    unsigned long long value;
+
+    if (0 == ct_read(&value, CT_CPU "cpufreq/scaling_cur_freq", cpu))
+    {
+      if (0 == online || value < set->min_khz)
+        set->min_khz = value;
+      if (value > set->max_khz)
+        set->max_khz = value;
+      if ((int)cpu == set->cpu)
+        set->cur_khz = value;
+      sum += value;
+      online++;
+    }
+
+    if (0 == ct_read(&value, CT_CPU "thermal_throttle/core_throttle_count", cpu))
+    {
+      core += value;
+      set->throttle_known = 1;
+    }
+    if (set->package_first[cpu] && 0 == ct_read(&value, CT_CPU "thermal_throttle/package_throttle_count", cpu))
+      package += value;
+
+    if (set->msr[cpu] >= 0)
+    {
+      unsigned long long aperf;
+      unsigned long long mperf;
+
+      if (0 == ct_msr(set->msr[cpu], CT_APERF, &aperf) && 0 == ct_msr(set->msr[cpu], CT_MPERF, &mperf))
+      {
+        if ((int)cpu == set->cpu && mperf != set->mperf[cpu] && set->mperf[cpu])
+          set->ratio = (double)(aperf - set->aperf[cpu]) / (mperf - set->mperf[cpu]);
+        set->aperf[cpu] = aperf;
+        set->mperf[cpu] = mperf;
+      }
+    }
+  }
+
+  if (online)
+    set->avg_khz = sum / online;
+
+  if (set->throttle_known)
+  {
+    set->core_throttle    = core - set->core_last;
+    set->package_throttle = package - set->package_last;
+    set->core_last        = core;
+    set->package_last     = package;
+  }
+
+  if (set->zones)
+  {
+    unsigned long long uj = 0;
+    int known = 1;
+
+    /* energy of the period is n/a if some zone has no value at its start
+       or end, the other zones still move to the end of the period */
+    for (zone = 0; zone < set->zones; zone++)
+    {
+      unsigned long long value;
+
+      if (ct_read(&value, CT_RAPL "energy_uj", set->zone[zone]) < 0)
+      {
+        set->zone_known[zone] = 0;
+        known = 0;
+        continue;
+      }
+
+      /* counter wraps at max_energy_range_uj */
+      if (!set->zone_known[zone])
+        known = 0;
+      else if (value >= set->zone_last[zone])
+        uj += value - set->zone_last[zone];
+      else
+        uj += set->zone_range[zone] - set->zone_last[zone] + value;
+      set->zone_last[zone]  = value;
+      set->zone_known[zone] = 1;
+    }
+    if (known)
+      set->joules = uj / 1e6;
+  }
+} /* ct_sample */
+
+void ct_print(const CT_SET* set, const char* prefix, unsigned long long loops)
+{
+  const double rate = (set->period > 0 ? loops / set->period : 0);
+  double ghz = 0;
+
+  printf ("%s", prefix);
+
+  if (set->cur_khz)
+    printf (" cpu%d %.2f GHz", set->cpu, set->cur_khz / 1e6);
+  else
+    printf (" cpu%d n/a GHz", set->cpu);
+  if (set->min_khz)
+    printf (" (all min %.2f avg %.2f max %.2f)", set->min_khz / 1e6, set->avg_khz / 1e6, set->max_khz / 1e6);
+
+  if (set->ratio > 0)
+  {
+    printf (", aperf/mperf %.2f", set->ratio);
+    if (set->base_khz)
+    {
+      ghz = set->ratio * set->base_khz / 1e6;
+      printf (" = %.2f GHz", ghz);
+    }
+  }
+  else
+    printf (", aperf/mperf n/a");
+
+  /* effective frequency is better than the requested one */
+  if (0 == ghz)
+    ghz = set->cur_khz / 1e6;
+
+  if (set->throttle_known)
+    printf (", throttled core %llu package %llu", set->core_throttle, set->package_throttle);
+  else
+    printf (", throttled n/a");
+
+  if (set->joules >= 0 && set->period > 0)
+    printf (", %.1f W", set->joules / set->period);
+  else
+    printf (", n/a W");
+
+  printf (", %.0f loops/s", rate);
+  if (set->joules > 0)
+    printf (", %.0f loops/J", loops / set->joules);
+  else
+    printf (", n/a loops/J");
+  if (ghz > 0)
+    printf (", %.0f loops/GHz\n", rate / ghz);
+  else
+    printf (", n/a loops/GHz\n");
+} /* ct_print */
+
+void ct_close(CT_SET* set)
+{
+  unsigned cpu;
+
+  for (cpu = 0; set->msr && cpu < set->cpus; cpu++)
+    if (set->msr[cpu] >= 0)
+      close(set->msr[cpu]);
+
+  free(set->msr);
+  free(set->aperf);
+  free(set->mperf);
+  free(set->package_first);
+  memset(set, 0, sizeof(*set));
+} /* ct_close */
+
+/* ========================================================================= *
+ *                    No more code in file cputelem.c                        *
+ * ========================================================================= */
@@ -0,0 +1,78 @@
+/* ========================================================================= *
+ * File: cputelem.h
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    CPU frequency, thermal throttling and energy telemetry, so that work
+ *    done by a load tool can be put in relation to the clock it ran at and
+ *    the energy it took. Sources are cpufreq scaling_cur_freq, APERF/MPERF
+ *    through /dev/cpu/N/msr, thermal_throttle counters and RAPL package zones of
+ *    powercap. Sources which are missing or not readable (msr and energy
+ *    usually need root) are reported as "n/a".
+ * ========================================================================= */
+
+#ifndef CPUTELEM_H
+#define CPUTELEM_H
+
+#define CT_ZONES  8  /* RAPL package zones followed at most */
+
+typedef struct
+{
+  /* sources, set up by ct_open */
+  unsigned            cpus;          /* configured CPUs                     */
+  int*                msr;           /* msr descriptor per CPU, -1 if none  */
+  unsigned long long* aperf;         /* APERF per CPU at previous sample    */
+  unsigned long long* mperf;         /* MPERF per CPU at previous sample    */
+  unsigned char*      package_first; /* CPU is the first one of its package */
+  unsigned long long  base_khz;      /* nominal frequency, 0 if not known   */
+  unsigned            zones;         /* RAPL package zones found            */
+  unsigned            zone[CT_ZONES];        /* intel-rapl:<zone> numbers    */
+  unsigned long long  zone_range[CT_ZONES];  /* max_energy_range_uj         */
+  unsigned long long  zone_last[CT_ZONES];   /* energy_uj at previous sample */
+  unsigned char       zone_known[CT_ZONES];  /* zone_last was read          */
+  unsigned long long  core_last;     /* throttle counts at previous sample  */
+  unsigned long long  package_last;
+  double              started;       /* time of previous sample, seconds   */
+
+  /* results of the latest ct_sample, 0 or -1 if not available */
+  double              period;        /* seconds since previous sample       */
+  int                 cpu;           /* CPU of the calling thread           */
+  unsigned long long  cur_khz;       /* scaling_cur_freq of that CPU        */
+  unsigned long long  min_khz;       /* over all online CPUs                */
+  unsigned long long  avg_khz;
+  unsigned long long  max_khz;
+  double              ratio;         /* APERF/MPERF delta of that CPU       */
+  int                 throttle_known;
+  unsigned long long  core_throttle; /* throttle events since previous      */
+  unsigned long long  package_throttle;
+  double              joules;        /* energy since previous, -1 if n/a    */
+} CT_SET;
+
+/* Finds available sources and takes the first sample, returns their number */
+int  ct_open(CT_SET* set);
+
+/* Samples all sources, results are relative to the previous sample */
+void ct_sample(CT_SET* set);
+
+/* Prints the latest sample and given work done in the period as one line */
+void ct_print(const CT_SET* set, const char* prefix, unsigned long long loops);
+
+/* Releases resources */
+void ct_close(CT_SET* set);
+
+#endif /* CPUTELEM_H */
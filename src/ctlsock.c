@@ -0,0 +1,301 @@
+/* ========================================================================= *
+ * File: ctlsock.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Runtime control socket, see ctlsock.h for details.
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ctlsock.h"
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+#define CS_CLIENTS  8     /* Simultaneously connected clients    */
+#define CS_LINE     256   /* Maximal length of command line      */
+
+typedef struct
+{
+  int      fd;               /* client socket or -1  */
+  unsigned used;             /* bytes in the buffer  */
+  char     line[CS_LINE];    /* partial command line */
+} CS_CLIENT;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static int        cs_fd = -1;
+static char       cs_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static CS_HANDLER cs_handler;
+static CS_CLIENT  cs_clients[CS_CLIENTS];
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * cs_drop -- disconnect client.
+ * parameters: client
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void cs_drop(CS_CLIENT* client)
+{
+  close(client->fd);
+  client->fd   = -1;
+  client->used = 0;
+} /* cs_drop */
+
+/* ------------------------------------------------------------------------- *
+ * cs_accept -- accept new connection if there is a free slot.
+ * parameters: nothing
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void cs_accept(void)
+{
+  unsigned index;
+  int fd = accept4(cs_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+  if (fd < 0)
+    return;
+
+  for (index = 0; index < CS_CLIENTS; index++)
+  {
+    if (cs_clients[index].fd < 0)
+    {
+      cs_clients[index].fd   = fd;
+      cs_clients[index].used = 0;
+      return;
+    }
+  }
+
+  /* too many clients */
+  close(fd);
+} /* cs_accept */
+
+/* ------------------------------------------------------------------------- *
+ * cs_read -- read data from client and handle all complete lines.
+ * parameters: client
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void cs_read(CS_CLIENT* client)
+{
+  const ssize_t got = read(client->fd, client->line + client->used, sizeof(client->line) - 1 - client->used);
+  char* eol;
+
+  if (got <= 0)
+  {
+    if (0 == got || (EAGAIN != errno && EINTR != errno))
+      cs_drop(client);
+    return;
+  }
+
+  client->used += got;
+  client->line[client->used] = 0;
+
+  while (NULL != (eol = strchr(client->line, '\n')))
+  {
+    char reply[CS_REPLY];
+    int  len;
+
+    *eol = 0;
+    if (eol > client->line && '\r' == eol[-1])
+      eol[-1] = 0;
+
+    reply[0] = 0;
+    cs_handler(client->line, reply, sizeof(reply) - 1);
+    len = strlen(reply);
+    reply[len++] = '\n';
+    if (send(client->fd, reply, len, MSG_NOSIGNAL | MSG_DONTWAIT) != len)
+    {
+      cs_drop(client);
+      return;
+    }
+
+    client->used -= (eol + 1 - client->line);
+    memmove(client->line, eol + 1, client->used + 1);
+  }
+
+  /* line is too long to be a command */
+  if (client->used >= sizeof(client->line) - 1)
+    cs_drop(client);
+} /* cs_read */
+
+/* ------------------------------------------------------------------------- *
+ * cs_stale -- remove socket left by previous run, nothing else.
+ * parameters: socket address
+ * returns: 0 if the path is free now, -1 if it is in use or not a socket.
+ * ------------------------------------------------------------------------- */
+
+static int cs_stale(const struct sockaddr_un* addr)
+{
+  struct stat st;
+  int fd;
+  int refused;
+
+  if (lstat(addr->sun_path, &st) < 0)
+    return 0;
+
+  if (!S_ISSOCK(st.st_mode))
+  {
+    printf ("control socket path %s exists and is not a socket\n", addr->sun_path);
+    return -1;
+  }
+
+  /* nobody listens on a stale socket */
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return 0;
+  refused = (connect(fd, (const struct sockaddr*)addr, sizeof(*addr)) < 0 && ECONNREFUSED == errno);
+  close(fd);
+
+  if (!refused)
+  {
+    printf ("control socket %s is in use by another process\n", addr->sun_path);
+    return -1;
+  }
+
+  unlink(addr->sun_path);
+  return 0;
+} /* cs_stale */
+
+/* ========================================================================= *
+ * Public methods.
+ * ========================================================================= */
+
+int cs_open(const char* path, CS_HANDLER handler)
+{
+  struct sockaddr_un addr;
+  unsigned index;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    printf ("control socket path %s is too long\n", path);
+    return -1;
+  }
+
+  cs_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (cs_fd < 0)
+  {
+    printf ("cannot create control socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if (cs_stale(&addr) < 0)
+  {
+    close(cs_fd);
+    cs_fd = -1;
+    return -1;
+  }
+
+  if (bind(cs_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(cs_fd, CS_CLIENTS) < 0)
+  {
+    printf ("cannot listen control socket %s: %s\n", path, strerror(errno));
+    close(cs_fd);
+    cs_fd = -1;
+    return -1;
+  }
+
+  strcpy(cs_path, path);
+  cs_handler = handler;
+  for (index = 0; index < CS_CLIENTS; index++)
+    cs_clients[index].fd = -1;
+
+  printf ("listening control socket %s\n", path);
+  return 0;
+} /* cs_open */
+
+void cs_poll(int timeout)
+{
+  struct pollfd fds[CS_CLIENTS + 1];
+  unsigned index;
+
+  if (cs_fd < 0)
+  {
+    if (timeout > 0)
+      poll(NULL, 0, timeout);
+    return;
+  }
+
+  fds[0].fd     = cs_fd;
+  fds[0].events = POLLIN;
+  for (index = 0; index < CS_CLIENTS; index++)
+  {
+    fds[index + 1].fd     = cs_clients[index].fd;   /* negative ones are ignored */
+    fds[index + 1].events = POLLIN;
+  }
+
+  if (poll(fds, CS_CLIENTS + 1, timeout) <= 0)
+    return;
+
+  for (index = 0; index < CS_CLIENTS; index++)
+    if (cs_clients[index].fd >= 0 && fds[index + 1].revents)
+      cs_read(cs_clients + index);
+
+  if (fds[0].revents & POLLIN)
+    cs_accept();
+} /* cs_poll */
+
+void cs_close(void)
+{
+  unsigned index;
+
+  if (cs_fd < 0)
+    return;
+
+  for (index = 0; index < CS_CLIENTS; index++)
+    if (cs_clients[index].fd >= 0)
+      cs_drop(cs_clients + index);
+
+  close(cs_fd);
+  cs_fd = -1;
+  unlink(cs_path);
+} /* cs_close */
+
+int cs_active(void)
+{
+  return (cs_fd >= 0);
+} /* cs_active */
+
+/* ========================================================================= *
+ *                    No more code in file ctlsock.c                         *
+ * ========================================================================= */
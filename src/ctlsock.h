@@ -0,0 +1,52 @@
+/* ========================================================================= *
+ * File: ctlsock.h
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Runtime control socket. A load tool listens on a UNIX domain stream
+ *    socket, every line received from a connected client is passed to the
+ *    handler of the tool and the reply is sent back as one line, e.g.
+ *      $ echo "set load 70" | socat - UNIX-CONNECT:/tmp/cpuload.ctl
+ *      ok
+ *    Sockets are polled by the tool between its load slices, so nothing
+ *    here blocks longer than the timeout given to cs_poll.
+ * ========================================================================= */
+
+#ifndef CTLSOCK_H
+#define CTLSOCK_H
+
+#include <stddef.h>
+
+#define CS_REPLY  256   /* Maximal length of reply */
+
+/* Handles one command line and fills reply without newline */
+typedef void (*CS_HANDLER)(const char* command, char* reply, size_t size);
+
+/* Creates listening socket at path, returns 0 if succeeded */
+int  cs_open(const char* path, CS_HANDLER handler);
+
+/* Handles pending connections and commands, waits up to timeout ms */
+void cs_poll(int timeout);
+
+/* Closes all sockets and removes socket file */
+void cs_close(void);
+
+/* Returns non-zero if control socket is open */
+int  cs_active(void);
+
+#endif /* CTLSOCK_H */
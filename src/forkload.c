@@ -0,0 +1,467 @@
+/* ========================================================================= *
+ * File: forkload.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Process creation load generator. The parent first dirties a given
+ *    amount of memory, so every fork() has to copy page tables of a large
+ *    address space, and then creates processes or threads at a target
+ *    rate from one or more creator threads:
+ *      fork   - fork(), child exits immediately
+ *      vfork  - vfork(), child exits immediately
+ *      spawn  - posix_spawn() of a small binary
+ *      exec   - fork() and execv() of a small binary, completion is
+ *               detected by close-on-exec pipe
+ *      thread - pthread_create() of a detached thread (clone3 in
+ *               recent C libraries)
+ *    Spawn latency percentiles and achieved rate are reported periodically.
+ *
+ *    Examples:
+ *      forkload -s 2048 -r 200 fork - 200 forks per second of 2 GB parent
+ *      forkload -t 4 -r 1000 -d 60 spawn - posix_spawn storm from 4 threads
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lathist.h"
+
+/* ========================================================================= *
+ * General settings.
+ * ========================================================================= */
+
+#define FL_REPORT         5             /* Default report period, seconds      */
+#define FL_EXEC           "/bin/true"   /* Default binary for spawn and exec   */
+#define FL_BACKLOG        1000000000ULL /* Schedule is reset if behind so much */
+
+#define FL_CAPACITY(a)    (sizeof(a) / sizeof(*a))
+
+extern char** environ;
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+typedef enum
+{
+  FL_Unknown,
+  FL_Fork,
+  FL_VFork,
+  FL_Spawn,
+  FL_Exec,
+  FL_Thread
+} FL_METHOD;
+
+typedef struct
+{
+  FL_METHOD   method;   /* how processes are created                  */
+  unsigned    rate;     /* creations per second in total, 0 unlimited */
+  unsigned    threads;  /* number of creator threads                  */
+  unsigned    rss;      /* MB of dirtied memory in parent             */
+  unsigned    t_limit;  /* seconds to run or 0 for unlimited          */
+  unsigned    report;   /* report period in seconds                   */
+  const char* binary;   /* binary for spawn and exec                  */
+} FL_OPTS;
+
+typedef struct
+{
+  pthread_t          thread;   /* creator thread                       */
+  pthread_mutex_t    lock;     /* protects the histogram and counters  */
+  LH_HIST            hist;     /* latencies since last report          */
+  unsigned long long failed;   /* failed creations since last report   */
+} FL_CREATOR;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static const char* method_names[] = { "unknown", "fork", "vfork", "spawn", "exec", "thread" };
+
+static FL_OPTS      opts;
+static FL_CREATOR*  creators;
+static volatile int done_flag;
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * fl_getmethod -- returns method by name.
+ * parameters: name
+ * returns: method or FL_Unknown.
+ * ------------------------------------------------------------------------- */
+
+static FL_METHOD fl_getmethod(const char* name)
+{
+  unsigned index;
+
+  for (index = 1; index < FL_CAPACITY(method_names); index++)
+    if (0 == strcmp(method_names[index], name))
+      return (FL_METHOD)index;
+
+  return FL_Unknown;
+} /* fl_getmethod */
+
+/* ------------------------------------------------------------------------- *
+ * fl_thread_body -- body of created thread, exits immediately.
+ * parameters: unused
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* fl_thread_body(void* arg)
+{
+  return arg;
+} /* fl_thread_body */
+
+/* ------------------------------------------------------------------------- *
+ * fl_create -- create one process or thread using selected method.
+ * parameters: nothing
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int fl_create(void)
+{
+  char* const argv[] = { (char*)opts.binary, NULL };
+  pid_t pid;
+
+  switch (opts.method)
+  {
+    case FL_Fork:
+      pid = fork();
+      if (0 == pid)
+        _exit(0);
+      return (pid < 0 ? -1 : 0);
+
+    case FL_VFork:
+      pid = vfork();
+      if (0 == pid)
+        _exit(0);
+      return (pid < 0 ? -1 : 0);
+
+    case FL_Spawn:
+      return (0 == posix_spawn(&pid, opts.binary, NULL, NULL, argv, environ) ? 0 : -1);
+
+    case FL_Exec:
+      {
+        int  fds[2];
+        char dummy;
+
+        if (pipe2(fds, O_CLOEXEC) < 0)
+          return -1;
+        pid = fork();
+        if (0 == pid)
+        {
+          execv(opts.binary, argv);
+          _exit(127);
+        }
+        close(fds[1]);
+        /* EOF comes when child has done exec (or exited) */
+        if (pid > 0)
+          while (read(fds[0], &dummy, 1) < 0 && EINTR == errno)
+            ;
+        close(fds[0]);
+        return (pid < 0 ? -1 : 0);
+      }
+
+    case FL_Thread:
+      {
+        pthread_attr_t attr;
+        pthread_t      thread;
+        int            error;
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        error = pthread_create(&thread, &attr, fl_thread_body, NULL);
+        pthread_attr_destroy(&attr);
+        return (error ? -1 : 0);
+      }
+
+    default:
+      break;
+  }
+
+  return -1;
+} /* fl_create */
+
+/* ------------------------------------------------------------------------- *
+ * fl_creator -- creator thread, creates processes according to schedule.
+ * parameters: creator
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* fl_creator(void* arg)
+{
+  FL_CREATOR* self = (FL_CREATOR*)arg;
+  const LH_NSEC period = (opts.rate ? 1000000000ULL * opts.threads / opts.rate : 0);
+  LH_NSEC due = lh_now();
+
+  while (!done_flag)
+  {
+    LH_NSEC started;
+    int     result;
+
+    if (period)
+    {
+      struct timespec wake;
+
+      due += period;
+      wake.tv_sec  = due / 1000000000ULL;
+      wake.tv_nsec = due % 1000000000ULL;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+
+      /* do not try to catch up after long stalls */
+      if (lh_now() > due + FL_BACKLOG)
+        due = lh_now();
+    }
+
+    started = lh_now();
+    result  = fl_create();
+    started = lh_now() - started;
+
+    pthread_mutex_lock(&self->lock);
+    if (result < 0)
+      self->failed++;
+    else
+      lh_add(&self->hist, started);
+    pthread_mutex_unlock(&self->lock);
+  }
+
+  return NULL;
+} /* fl_creator */
+
+/* ------------------------------------------------------------------------- *
+ * fl_collect -- collect and reset interval statistics of all creators.
+ * parameters: histogram to merge to, failures counter
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void fl_collect(LH_HIST* hist, unsigned long long* failed)
+{
+  unsigned index;
+
+  lh_init(hist);
+  *failed = 0;
+  for (index = 0; index < opts.threads; index++)
+  {
+    pthread_mutex_lock(&creators[index].lock);
+    lh_merge(hist, &creators[index].hist);
+    *failed += creators[index].failed;
+    lh_init(&creators[index].hist);
+    creators[index].failed = 0;
+    pthread_mutex_unlock(&creators[index].lock);
+  }
+} /* fl_collect */
+
+/* ------------------------------------------------------------------------- *
+ * fl_done_handler -- handler for termination signal.
+ * parameters: signal received
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void fl_done_handler(int signo)
+{
+  /* Make compiler happy */
+  signo = signo;
+  done_flag = 1;
+} /* fl_done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * fl_usage -- show usage of application
+ * parameters: application name
+ * returns: 1.
+ * ------------------------------------------------------------------------- */
+
+static int fl_usage(const char* self)
+{
+  printf ("\nUsage: %s [-r <rate>] [-s <MB>] [-t <threads>] [-d <secs>] [-i <secs>] [-e <binary>] <method>\n", self);
+  printf ("\nMethods:\n");
+  printf ("  fork\t\tfork(), child exits immediately.\n");
+  printf ("  vfork\t\tvfork(), child exits immediately.\n");
+  printf ("  spawn\t\tposix_spawn() of the binary.\n");
+  printf ("  exec\t\tfork() and execv() of the binary, latency includes exec.\n");
+  printf ("  thread\tpthread_create() of a thread which exits immediately.\n");
+  printf ("\nOptions:\n");
+  printf ("  -r\t\tcreations per second in total, default is unlimited.\n");
+  printf ("  -s\t\tMB of memory dirtied in parent before creations start.\n");
+  printf ("  -t\t\tnumber of parallel creator threads, default 1.\n");
+  printf ("  -d\t\ttest duration in seconds, default is until terminated.\n");
+  printf ("  -i\t\treport period, default %u seconds.\n", FL_REPORT);
+  printf ("  -e\t\tbinary for spawn and exec, default %s.\n", FL_EXEC);
+  printf ("\nExample:\n");
+  printf ("  %s -s 2048 -r 200 fork\n", self);
+  printf ("  %s -t 4 -r 1000 -d 60 spawn\n", self);
+  printf ("\n");
+  return 1;
+} /* fl_usage */
+
+/* ========================================================================= *
+ * Main function.
+ * ========================================================================= */
+
+int main(int argc, char* const argv[])
+{
+  LH_HIST  total;
+  LH_HIST  interval;
+  LH_NSEC  started;
+  LH_NSEC  last;
+  unsigned long long failed;
+  unsigned long long total_failed = 0;
+  unsigned index;
+  int      c;
+
+  printf ("process creation load generator, build %s %s\n", __DATE__, __TIME__);
+
+  memset(&opts, 0, sizeof(opts));
+  opts.threads = 1;
+  opts.report  = FL_REPORT;
+  opts.binary  = FL_EXEC;
+
+  opterr = 0;
+  while ((c = getopt(argc, argv, "r:s:t:d:i:e:")) != -1)
+  {
+    switch (c)
+    {
+      case 'r':
+        opts.rate = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        opts.rss = strtoul(optarg, NULL, 0);
+        break;
+      case 't':
+        opts.threads = strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        opts.t_limit = strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        opts.report = strtoul(optarg, NULL, 0);
+        break;
+      case 'e':
+        opts.binary = optarg;
+        break;
+      default:
+        return fl_usage(argv[0]);
+    }
+  }
+
+  if (optind != argc - 1 || 0 == opts.threads || 0 == opts.report)
+    return fl_usage(argv[0]);
+
+  opts.method = fl_getmethod(argv[optind]);
+  if (FL_Unknown == opts.method)
+    return fl_usage(argv[0]);
+
+  if (opts.rss)
+  {
+    const size_t size = (size_t)opts.rss << 20;
+    char* data = (char*)malloc(size);
+
+    if (NULL == data)
+    {
+      printf ("no space available for %u MB parent\n", opts.rss);
+      return 1;
+    }
+    memset(data, 0x55, size);
+    printf ("parent has %u MB dirtied\n", opts.rss);
+  }
+
+  printf ("creating with %s from %u threads", method_names[opts.method], opts.threads);
+  if (opts.rate)
+    printf (" at %u per second", opts.rate);
+  printf ("\n");
+
+  /* children are reaped by kernel */
+  signal(SIGCHLD, SIG_IGN);
+  signal(SIGINT,  fl_done_handler);
+  signal(SIGTERM, fl_done_handler);
+
+  creators = (FL_CREATOR*)calloc(opts.threads, sizeof(*creators));
+  if (NULL == creators)
+  {
+    printf ("no memory available\n");
+    return 1;
+  }
+
+  lh_init(&total);
+  started = last = lh_now();
+  for (index = 0; index < opts.threads; index++)
+  {
+    pthread_mutex_init(&creators[index].lock, NULL);
+    lh_init(&creators[index].hist);
+    if (pthread_create(&creators[index].thread, NULL, fl_creator, creators + index))
+    {
+      printf ("cannot create creator thread %u\n", index + 1);
+      return 1;
+    }
+  }
+
+  while (!done_flag)
+  {
+    LH_NSEC now;
+    char    prefix[64];
+
+    sleep(opts.report);
+    if (opts.t_limit && lh_now() - started >= opts.t_limit * 1000000000ULL)
+      done_flag = 1;
+
+    now = lh_now();
+    fl_collect(&interval, &failed);
+    lh_merge(&total, &interval);
+    total_failed += failed;
+
+    snprintf(prefix, sizeof(prefix), "%7.1f s: %.1f/s failed %llu latency",
+             (now - started) / 1e9, interval.count * 1e9 / (now - last), failed);
+    lh_print(&interval, prefix);
+    fflush(stdout);
+    last = now;
+  }
+
+  for (index = 0; index < opts.threads; index++)
+    pthread_join(creators[index].thread, NULL);
+
+  fl_collect(&interval, &failed);
+  lh_merge(&total, &interval);
+  total_failed += failed;
+
+  last = lh_now();
+  printf ("total: %llu %s in %.1f s, achieved %.1f/s, failed %llu\n",
+          total.count, method_names[opts.method], (last - started) / 1e9,
+          total.count * 1e9 / (last - started), total_failed);
+  lh_print(&total, "total: latency");
+
+  return 0;
+} /* main */
+
+/* ========================================================================= *
+ *                    No more code in file forkload.c                        *
+ * ========================================================================= */
@@ -0,0 +1,714 @@
+/* ========================================================================= *
+ * File: ipcload.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Context switch and IPC load generator. Members of a ring (a pair by
+ *    default) pass a token to each other, so every hand-off wakes up the
+ *    next member. The first member of every ring starts rounds at a target
+ *    rate and measures the round trip time. Transports:
+ *      pipe    - one byte through pipe
+ *      unix    - one byte through UNIX stream socket pair
+ *      eventfd - counter increment of eventfd
+ *      futex   - futex word, FUTEX_WAKE and FUTEX_WAIT
+ *    Members are threads or processes and can be pinned to the same core
+ *    or spread over different cores.
+ *
+ *    Examples:
+ *      ipcload -a same pipe - one pair of threads on one core, unlimited
+ *      ipcload -p -n 4 -g 3 -r 10000 -s f futex - 4 rings of 3 processes
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lathist.h"
+#include "schedopt.h"
+
+/* ========================================================================= *
+ * General settings.
+ * ========================================================================= */
+
+#define IL_REPORT         5             /* Default report period, seconds      */
+#define IL_MEMBERS        64            /* Maximal number of members in ring   */
+#define IL_BACKLOG        1000000000ULL /* Schedule is reset if behind so much */
+#define IL_GO             1             /* Token value for the next round      */
+#define IL_STOP           2             /* Token value to finish the ring      */
+
+#define IL_CAPACITY(a)    (sizeof(a) / sizeof(*a))
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+typedef enum
+{
+  IL_Unknown,
+  IL_Pipe,
+  IL_Unix,
+  IL_Eventfd,
+  IL_Futex
+} IL_TRANSPORT;
+
+typedef enum
+{
+  IL_Free,            /* Scheduler places members       */
+  IL_Same,            /* Members of ring share one core */
+  IL_Spread           /* Every member has its own core  */
+} IL_PIN;
+
+typedef struct
+{
+  IL_TRANSPORT transport; /* how the token is passed                  */
+  unsigned     members;   /* members in every ring                    */
+  unsigned     rings;     /* number of rings                          */
+  unsigned     rate;      /* round trips per second per ring or 0     */
+  int          processes; /* members are processes instead of threads */
+  IL_PIN       pin;       /* core selection of members                */
+  char         sched_id;  /* scheduling policy id or 0                */
+  int          sched_prio;/* real-time priority or -1 for the highest */
+  unsigned     t_limit;   /* seconds to run or 0 for unlimited        */
+  unsigned     report;    /* report period in seconds                 */
+} IL_OPTS;
+
+/* Shared with member processes, so lives in MAP_SHARED memory */
+typedef struct
+{
+  pthread_mutex_t lock;               /* protects the histogram            */
+  LH_HIST         hist;               /* round trips since last report     */
+  volatile int    stop;               /* set by main, seen by first member */
+  int             fds[IL_MEMBERS][2]; /* read and write end per member     */
+  int             futex[IL_MEMBERS];  /* futex word per member             */
+  unsigned        index;              /* ring number                       */
+} IL_RING;
+
+typedef struct
+{
+  IL_RING*  ring;     /* ring of the member      */
+  unsigned  member;   /* position in the ring    */
+  pthread_t thread;   /* thread in thread mode   */
+  pid_t     pid;      /* process in process mode */
+} IL_MEMBER;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static const char* transport_names[] = { "unknown", "pipe", "unix", "eventfd", "futex" };
+static const char* pin_names[]       = { "free", "same", "spread" };
+
+static IL_OPTS      opts;
+static IL_RING*     rings;
+static IL_MEMBER*   members;
+static volatile int done_flag;
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * il_lookup -- returns index of name in the table.
+ * parameters: table, its size, name
+ * returns: index or 0 if not found (entry 0 is reserved).
+ * ------------------------------------------------------------------------- */
+
+static unsigned il_lookup(const char* const* table, unsigned size, const char* name)
+{
+  unsigned index;
+
+  for (index = 0; index < size; index++)
+    if (0 == strcmp(table[index], name))
+      return index;
+
+  return 0;
+} /* il_lookup */
+
+/* ------------------------------------------------------------------------- *
+ * il_futex -- futex system call, private unless members are processes.
+ * parameters: futex word, operation, value
+ * returns: result of syscall.
+ * ------------------------------------------------------------------------- */
+
+static long il_futex(int* word, int op, int value)
+{
+  if ( !opts.processes )
+    op |= FUTEX_PRIVATE_FLAG;
+  return syscall(SYS_futex, word, op, value, NULL, NULL, 0);
+} /* il_futex */
+
+/* ------------------------------------------------------------------------- *
+ * il_signal -- pass token to the member.
+ * parameters: ring, member, token value
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void il_signal(IL_RING* ring, unsigned member, int token)
+{
+  switch (opts.transport)
+  {
+    case IL_Pipe:
+    case IL_Unix:
+      {
+        const char byte = (char)token;
+        while (write(ring->fds[member][1], &byte, 1) < 0 && EINTR == errno)
+          ;
+      }
+      break;
+
+    case IL_Eventfd:
+      {
+        const uint64_t value = token;
+        while (write(ring->fds[member][1], &value, sizeof(value)) < 0 && EINTR == errno)
+          ;
+      }
+      break;
+
+    case IL_Futex:
+      __atomic_store_n(ring->futex + member, token, __ATOMIC_RELEASE);
+      il_futex(ring->futex + member, FUTEX_WAKE, 1);
+      break;
+
+    default:
+      break;
+  }
+} /* il_signal */
+
+/* ------------------------------------------------------------------------- *
+ * il_wait -- wait for token of the member.
+ * parameters: ring, member
+ * returns: token value, IL_STOP on errors.
+ * ------------------------------------------------------------------------- */
+
+static int il_wait(IL_RING* ring, unsigned member)
+{
+  ssize_t got;
+
+  switch (opts.transport)
+  {
+    case IL_Pipe:
+    case IL_Unix:
+      {
+        char byte;
+        while ((got = read(ring->fds[member][0], &byte, 1)) < 0 && EINTR == errno)
+          ;
+        return (1 == got ? byte : IL_STOP);
+      }
+
+    case IL_Eventfd:
+      {
+        uint64_t value;
+        while ((got = read(ring->fds[member][0], &value, sizeof(value))) < 0 && EINTR == errno)
+          ;
+        return (sizeof(value) == got ? (int)value : IL_STOP);
+      }
+
+    case IL_Futex:
+      {
+        int token;
+        while (0 == (token = __atomic_exchange_n(ring->futex + member, 0, __ATOMIC_ACQUIRE)))
+          il_futex(ring->futex + member, FUTEX_WAIT, 0);
+        return token;
+      }
+
+    default:
+      break;
+  }
+
+  return IL_STOP;
+} /* il_wait */
+
+/* ------------------------------------------------------------------------- *
+ * il_pin -- pin calling member to its core according to pin mode.
+ * parameters: member
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void il_pin(const IL_MEMBER* self)
+{
+  const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  cpu_set_t  set;
+  unsigned   core;
+
+  if (IL_Free == opts.pin || cores < 1)
+    return;
+
+  if (IL_Same == opts.pin)
+    core = self->ring->index % cores;
+  else
+    core = (self->ring->index * opts.members + self->member) % cores;
+
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) < 0)
+    printf ("cannot pin ring %u member %u to core %u: %s\n", self->ring->index + 1, self->member + 1, core, strerror(errno));
+} /* il_pin */
+
+/* ------------------------------------------------------------------------- *
+ * il_first -- first member of ring, starts rounds and measures them.
+ * parameters: ring
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void il_first(IL_RING* ring)
+{
+  const LH_NSEC period = (opts.rate ? 1000000000ULL / opts.rate : 0);
+  LH_NSEC due = lh_now();
+
+  while (!ring->stop)
+  {
+    LH_NSEC started;
+
+    if (period)
+    {
+      struct timespec wake;
+
+      due += period;
+      wake.tv_sec  = due / 1000000000ULL;
+      wake.tv_nsec = due % 1000000000ULL;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+
+      /* do not try to catch up after long stalls */
+      if (lh_now() > due + IL_BACKLOG)
+        due = lh_now();
+    }
+
+    started = lh_now();
+    il_signal(ring, 1, IL_GO);
+    if (IL_GO != il_wait(ring, 0))
+      return;
+    started = lh_now() - started;
+
+    pthread_mutex_lock(&ring->lock);
+    lh_add(&ring->hist, started);
+    pthread_mutex_unlock(&ring->lock);
+  }
+
+  /* let the stop token go around */
+  il_signal(ring, 1, IL_STOP);
+  il_wait(ring, 0);
+} /* il_first */
+
+/* ------------------------------------------------------------------------- *
+ * il_member -- body of ring member thread or process.
+ * parameters: member
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* il_member(void* arg)
+{
+  IL_MEMBER* self = (IL_MEMBER*)arg;
+  IL_RING*   ring = self->ring;
+  const unsigned next = (self->member + 1) % opts.members;
+
+  il_pin(self);
+
+  if (0 == self->member)
+  {
+    il_first(ring);
+    return NULL;
+  }
+
+  /* only the first member decides when to stop */
+  while (1)
+  {
+    const int token = il_wait(ring, self->member);
+
+    il_signal(ring, next, token);
+    if (IL_GO != token)
+      break;
+  }
+
+  return NULL;
+} /* il_member */
+
+/* ------------------------------------------------------------------------- *
+ * il_setup -- create shared rings and their channels.
+ * parameters: nothing
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int il_setup(void)
+{
+  const size_t size = opts.rings * sizeof(*rings);
+  pthread_mutexattr_t attr;
+  unsigned index;
+  unsigned member;
+
+  rings = (IL_RING*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == (void*)rings)
+  {
+    printf ("no memory available\n");
+    return -1;
+  }
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+
+  for (index = 0; index < opts.rings; index++)
+  {
+    IL_RING* ring = rings + index;
+
+    pthread_mutex_init(&ring->lock, &attr);
+    lh_init(&ring->hist);
+    ring->index = index;
+
+    for (member = 0; member < opts.members; member++)
+    {
+      int result = 0;
+
+      switch (opts.transport)
+      {
+        case IL_Pipe:
+          result = pipe(ring->fds[member]);
+          break;
+        case IL_Unix:
+          result = socketpair(AF_UNIX, SOCK_STREAM, 0, ring->fds[member]);
+          break;
+        case IL_Eventfd:
+          result = ring->fds[member][0] = ring->fds[member][1] = eventfd(0, 0);
+          break;
+        default:
+          break;
+      }
+
+      if (result < 0)
+      {
+        printf ("cannot create %s channel: %s\n", transport_names[opts.transport], strerror(errno));
+        return -1;
+      }
+    }
+  }
+
+  pthread_mutexattr_destroy(&attr);
+  return 0;
+} /* il_setup */
+
+/* ------------------------------------------------------------------------- *
+ * il_start -- create all members.
+ * parameters: nothing
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int il_start(void)
+{
+  unsigned index;
+
+  members = (IL_MEMBER*)calloc(opts.rings * opts.members, sizeof(*members));
+  if (NULL == members)
+  {
+    printf ("no memory available\n");
+    return -1;
+  }
+
+  for (index = 0; index < opts.rings * opts.members; index++)
+  {
+    IL_MEMBER* self = members + index;
+
+    self->ring   = rings + index / opts.members;
+    self->member = index % opts.members;
+
+    if (opts.processes)
+    {
+      self->pid = fork();
+      if (0 == self->pid)
+      {
+        /* main process stops the rings */
+        signal(SIGINT,  SIG_IGN);
+        signal(SIGTERM, SIG_DFL);
+        il_member(self);
+        _exit(0);
+      }
+      if (self->pid < 0)
+      {
+        printf ("cannot create member process: %s\n", strerror(errno));
+        return -1;
+      }
+    }
+    else if (pthread_create(&self->thread, NULL, il_member, self))
+    {
+      printf ("cannot create member thread\n");
+      return -1;
+    }
+  }
+
+  return 0;
+} /* il_start */
+
+/* ------------------------------------------------------------------------- *
+ * il_collect -- collect and reset interval statistics of all rings.
+ * parameters: histogram to merge to
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void il_collect(LH_HIST* hist)
+{
+  unsigned index;
+
+  lh_init(hist);
+  for (index = 0; index < opts.rings; index++)
+  {
+    pthread_mutex_lock(&rings[index].lock);
+    lh_merge(hist, &rings[index].hist);
+    lh_init(&rings[index].hist);
+    pthread_mutex_unlock(&rings[index].lock);
+  }
+} /* il_collect */
+
+/* ------------------------------------------------------------------------- *
+ * il_ctxt -- system-wide number of context switches.
+ * parameters: nothing
+ * returns: ctxt from /proc/stat or 0.
+ * ------------------------------------------------------------------------- */
+
+static unsigned long long il_ctxt(void)
+{
+  FILE* fp = fopen("/proc/stat", "r");
+  unsigned long long ctxt = 0;
+  char line[256];
+
+  if ( !fp )
+    return 0;
+
+  while ( fgets(line, sizeof(line), fp) )
+    if (1 == sscanf(line, "ctxt %llu", &ctxt))
+      break;
+
+  fclose(fp);
+  return ctxt;
+} /* il_ctxt */
+
+/* ------------------------------------------------------------------------- *
+ * il_print -- print rates and round trip latency.
+ * parameters: time label, histogram, context switches, period ns
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void il_print(const char* when, const LH_HIST* hist, unsigned long long ctxt, LH_NSEC period)
+{
+  char prefix[128];
+
+  snprintf(prefix, sizeof(prefix), "%s %.1f round trips/s, %.1f hand-offs/s, %.1f ctxt/s, rtt",
+           when, hist->count * 1e9 / period, hist->count * opts.members * 1e9 / period, ctxt * 1e9 / period);
+  lh_print(hist, prefix);
+} /* il_print */
+
+/* ------------------------------------------------------------------------- *
+ * il_done_handler -- handler for termination signal.
+ * parameters: signal received
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void il_done_handler(int signo)
+{
+  /* Make compiler happy */
+  signo = signo;
+  done_flag = 1;
+} /* il_done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * il_usage -- show usage of application
+ * parameters: application name
+ * returns: 1.
+ * ------------------------------------------------------------------------- */
+
+static int il_usage(const char* self)
+{
+  printf ("\nUsage: %s [-g <members>] [-n <rings>] [-r <rate>] [-p] [-a <pin>] [-s <id>[:<prio>]] [-d <secs>] [-i <secs>] <transport>\n", self);
+  printf ("\nTransports:\n");
+  printf ("  pipe\t\tone byte through pipe.\n");
+  printf ("  unix\t\tone byte through UNIX stream socket pair.\n");
+  printf ("  eventfd\tincrement of eventfd counter.\n");
+  printf ("  futex\t\tfutex word with FUTEX_WAKE and FUTEX_WAIT.\n");
+  printf ("\nOptions:\n");
+  printf ("  -g\t\tmembers in every ring, default 2 (ping-pong pair), up to %u.\n", IL_MEMBERS);
+  printf ("  -n\t\tnumber of rings, default 1.\n");
+  printf ("  -r\t\tround trips per second of every ring, default is unlimited.\n");
+  printf ("  -p\t\tmembers are processes, default is threads.\n");
+  printf ("  -a\t\tpinning: free (default), same core for ring, spread over cores.\n");
+  printf ("  -s\t\tscheduling policy of members, optionally with real-time priority:\n");
+  printf (SO_USAGE);
+  printf ("  -d\t\ttest duration in seconds, default is until terminated.\n");
+  printf ("  -i\t\treport period, default %u seconds.\n", IL_REPORT);
+  printf ("\nExample:\n");
+  printf ("  %s -a same pipe\n", self);
+  printf ("  %s -p -n 4 -g 3 -r 10000 -s f futex\n", self);
+  printf ("\n");
+  return 1;
+} /* il_usage */
+
+/* ========================================================================= *
+ * Main function.
+ * ========================================================================= */
+
+int main(int argc, char* const argv[])
+{
+  LH_HIST  total;
+  LH_HIST  interval;
+  LH_NSEC  started;
+  LH_NSEC  last;
+  unsigned long long ctxt_start;
+  unsigned long long ctxt_last;
+  unsigned index;
+  int      c;
+
+  printf ("context switch and IPC load generator, build %s %s\n", __DATE__, __TIME__);
+
+  memset(&opts, 0, sizeof(opts));
+  opts.members    = 2;
+  opts.rings      = 1;
+  opts.sched_prio = -1;
+  opts.report     = IL_REPORT;
+
+  opterr = 0;
+  while ((c = getopt(argc, argv, "g:n:r:pa:s:d:i:")) != -1)
+  {
+    switch (c)
+    {
+      case 'g':
+        opts.members = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        opts.rings = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        opts.rate = strtoul(optarg, NULL, 0);
+        break;
+      case 'p':
+        opts.processes = 1;
+        break;
+      case 'a':
+        opts.pin = (IL_PIN)il_lookup(pin_names, IL_CAPACITY(pin_names), optarg);
+        if (IL_Free == opts.pin && strcmp(optarg, pin_names[IL_Free]))
+          return il_usage(argv[0]);
+        break;
+      case 's':
+        if (so_parse(optarg, &opts.sched_id, &opts.sched_prio) < 0)
+          return il_usage(argv[0]);
+        break;
+      case 'd':
+        opts.t_limit = strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        opts.report = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        return il_usage(argv[0]);
+    }
+  }
+
+  if (optind != argc - 1 || opts.members < 2 || opts.members > IL_MEMBERS || 0 == opts.rings || 0 == opts.report)
+    return il_usage(argv[0]);
+
+  opts.transport = (IL_TRANSPORT)il_lookup(transport_names, IL_CAPACITY(transport_names), argv[optind]);
+  if (IL_Unknown == opts.transport)
+    return il_usage(argv[0]);
+
+  printf ("%u rings of %u %s over %s, %s pinning", opts.rings, opts.members,
+          (opts.processes ? "processes" : "threads"), transport_names[opts.transport], pin_names[opts.pin]);
+  if (opts.rate)
+    printf (", %u round trips per second per ring", opts.rate);
+  printf ("\n");
+
+  /* members inherit policy of main thread */
+  if (opts.sched_id)
+    so_apply(opts.sched_id, opts.sched_prio, "member");
+
+  signal(SIGINT,  il_done_handler);
+  signal(SIGTERM, il_done_handler);
+
+  if (il_setup() < 0)
+    return 1;
+
+  lh_init(&total);
+  ctxt_start = ctxt_last = il_ctxt();
+  started = last = lh_now();
+  if (il_start() < 0)
+  {
+    /* blocked members would wait forever */
+    for (index = 0; index < opts.rings * opts.members; index++)
+      if (members[index].pid > 0)
+        kill(members[index].pid, SIGTERM);
+    return 1;
+  }
+
+  while (!done_flag)
+  {
+    unsigned long long ctxt;
+    LH_NSEC now;
+    char    when[32];
+
+    sleep(opts.report);
+    if (opts.t_limit && lh_now() - started >= opts.t_limit * 1000000000ULL)
+      done_flag = 1;
+
+    now  = lh_now();
+    ctxt = il_ctxt();
+    snprintf(when, sizeof(when), "%7.1f s:", (now - started) / 1e9);
+    il_collect(&interval);
+    lh_merge(&total, &interval);
+    il_print(when, &interval, ctxt - ctxt_last, now - last);
+    fflush(stdout);
+    ctxt_last = ctxt;
+    last = now;
+  }
+
+  for (index = 0; index < opts.rings; index++)
+    rings[index].stop = 1;
+
+  for (index = 0; index < opts.rings * opts.members; index++)
+  {
+    if (opts.processes)
+      waitpid(members[index].pid, NULL, 0);
+    else
+      pthread_join(members[index].thread, NULL);
+  }
+
+  il_collect(&interval);
+  lh_merge(&total, &interval);
+
+  last = lh_now();
+  printf ("total: %llu round trips in %.1f s\n", total.count, (last - started) / 1e9);
+  il_print("total:", &total, il_ctxt() - ctxt_start, last - started);
+
+  return 0;
+} /* main */
+
+/* ========================================================================= *
+ *                    No more code in file ipcload.c                         *
+ * ========================================================================= */
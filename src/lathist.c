@@ -0,0 +1,157 @@
+/* ========================================================================= *
+ * File: lathist.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Latency histogram, see lathist.h for details.
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "lathist.h"
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * lh_index -- find bucket for the value.
+ * parameters: value
+ * returns: bucket index.
+ * ------------------------------------------------------------------------- */
+
+static unsigned lh_index(LH_NSEC value)
+{
+  unsigned msb;
+
+  if (value < LH_SUB)
+    return (unsigned)value;
+
+  msb = 63 - __builtin_clzll(value);
+  return (msb - LH_SUB_SHIFT + 1) * LH_SUB +
+         (unsigned)((value >> (msb - LH_SUB_SHIFT)) - LH_SUB);
+} /* lh_index */
+
+/* ------------------------------------------------------------------------- *
+ * lh_upper -- find largest value which goes to the bucket.
+ * parameters: bucket index
+ * returns: value.
+ * ------------------------------------------------------------------------- */
+
+static LH_NSEC lh_upper(unsigned index)
+{
+  const unsigned group = index / LH_SUB;
+  const unsigned sub   = index % LH_SUB;
+
+  if (0 == group)
+    return sub;
+
+  return (((LH_NSEC)(LH_SUB + sub + 1)) << (group - 1)) - 1;
+} /* lh_upper */
+
+/* ========================================================================= *
+ * Public methods.
+ * ========================================================================= */
+
+LH_NSEC lh_now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (LH_NSEC)now.tv_sec * 1000000000ULL + now.tv_nsec;
+} /* lh_now */
+
+void lh_init(LH_HIST* hist)
+{
+  memset(hist, 0, sizeof(*hist));
+} /* lh_init */
+
+void lh_add(LH_HIST* hist, LH_NSEC value)
+{
+  if (0 == hist->count || value < hist->min)
+    hist->min = value;
+  if (value > hist->max)
+    hist->max = value;
+  hist->count++;
+  hist->sum += value;
+  hist->bucket[lh_index(value)]++;
+} /* lh_add */
+
+void lh_merge(LH_HIST* hist, const LH_HIST* other)
+{
+  unsigned index;
+
+  if (0 == other->count)
+    return;
+
+  if (0 == hist->count || other->min < hist->min)
+    hist->min = other->min;
+  if (other->max > hist->max)
+    hist->max = other->max;
+  hist->count += other->count;
+  hist->sum   += other->sum;
+
+  for (index = 0; index < LH_BUCKETS; index++)
+    hist->bucket[index] += other->bucket[index];
+} /* lh_merge */
+
+LH_NSEC lh_percentile(const LH_HIST* hist, double percent)
+{
+  const long double wanted = hist->count * percent / 100.0;
+  unsigned long long seen = 0;
+  unsigned index;
+
+  if (0 == hist->count)
+    return 0;
+
+  for (index = 0; index < LH_BUCKETS; index++)
+  {
+    seen += hist->bucket[index];
+    if (seen && seen >= wanted)
+    {
+      const LH_NSEC upper = lh_upper(index);
+      return (upper < hist->max ? upper : hist->max);
+    }
+  }
+
+  return hist->max;
+} /* lh_percentile */
+
+void lh_print(const LH_HIST* hist, const char* prefix)
+{
+  if (0 == hist->count)
+  {
+    printf ("%s n 0\n", prefix);
+    return;
+  }
+
+  printf ("%s n %llu min %.1f avg %.1f p50 %.1f p99 %.1f p99.9 %.1f max %.1f us\n",
+          prefix, hist->count, hist->min / 1e3, (double)(hist->sum / hist->count) / 1e3,
+          lh_percentile(hist, 50.0) / 1e3, lh_percentile(hist, 99.0) / 1e3,
+          lh_percentile(hist, 99.9) / 1e3, hist->max / 1e3);
+} /* lh_print */
+
+/* ========================================================================= *
+ *                    No more code in file lathist.c                         *
+ * ========================================================================= */
@@ -0,0 +1,64 @@
+/* ========================================================================= *
+ * File: lathist.h
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Latency histogram with logarithmic buckets, each power of two is
+ *    split into LH_SUB linear sub-buckets, so percentiles are precise
+ *    to about 6% for any value from nanoseconds to minutes while the
+ *    histogram has a fixed size and needs no sample storage.
+ * ========================================================================= */
+
+#ifndef LATHIST_H
+#define LATHIST_H
+
+#define LH_SUB_SHIFT  4
+#define LH_SUB        (1 << LH_SUB_SHIFT)      /* sub-buckets per power of two */
+#define LH_GROUPS     (64 - LH_SUB_SHIFT + 1)  /* powers of two to cover      */
+#define LH_BUCKETS    (LH_GROUPS * LH_SUB)
+
+typedef unsigned long long LH_NSEC;
+
+typedef struct
+{
+  unsigned long long count;                /* number of samples           */
+  LH_NSEC            min;                  /* smallest sample             */
+  LH_NSEC            max;                  /* largest sample              */
+  long double        sum;                  /* sum of samples for average  */
+  unsigned long long bucket[LH_BUCKETS];   /* samples per bucket          */
+} LH_HIST;
+
+/* Current CLOCK_MONOTONIC time in nanoseconds */
+LH_NSEC lh_now(void);
+
+/* Resets histogram */
+void    lh_init(LH_HIST* hist);
+
+/* Adds one sample in nanoseconds */
+void    lh_add(LH_HIST* hist, LH_NSEC value);
+
+/* Adds all samples of the second histogram to the first one */
+void    lh_merge(LH_HIST* hist, const LH_HIST* other);
+
+/* Returns value below which the given percent of samples fall */
+LH_NSEC lh_percentile(const LH_HIST* hist, double percent);
+
+/* Prints sample count, min, p50, p99, p99.9 and max in microseconds */
+void    lh_print(const LH_HIST* hist, const char* prefix);
+
+#endif /* LATHIST_H */
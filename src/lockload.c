@@ -0,0 +1,429 @@
+/* ========================================================================= *
+ * File: lockload.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Lock contention load generator. Threads contend on one primitive:
+ *      mutex   - pthread mutex around shared counter update
+ *      spin    - pthread spinlock around shared counter update
+ *      rwlock  - pthread rwlock, given percent of writers
+ *      atomic  - atomic fetch-add on one shared cache line
+ *      false   - per-thread counters packed into shared cache lines
+ *      padded  - per-thread counters on own cache lines, the control
+ *    Critical section length is given in loops of dependent arithmetic.
+ *    Operations per second of every thread and fairness between threads
+ *    (Jain's index, 1.0 is perfectly fair) are reported periodically.
+ *
+ *    Examples:
+ *      lockload -t 8 -c 100 mutex  - lock convoy of 8 threads
+ *      lockload -t 8 false         - false sharing, compare with padded
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lathist.h"
+
+/* ========================================================================= *
+ * General settings.
+ * ========================================================================= */
+
+#define LL_REPORT         5             /* Default report period, seconds  */
+#define LL_WRITERS        50            /* Default rwlock writers, percent */
+#define LL_CACHE_LINE     64            /* Size of padding                 */
+
+#define LL_CAPACITY(a)    (sizeof(a) / sizeof(*a))
+#define LL_LOCKED(type)   struct { type lock; volatile unsigned long long counter; } \
+                          __attribute__((aligned(LL_CACHE_LINE)))
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+typedef enum
+{
+  LL_Unknown,
+  LL_Mutex,
+  LL_Spin,
+  LL_RWLock,
+  LL_Atomic,
+  LL_False,
+  LL_Padded
+} LL_PRIMITIVE;
+
+typedef struct
+{
+  LL_PRIMITIVE primitive; /* what threads contend on               */
+  unsigned     threads;   /* number of threads                     */
+  unsigned     critical;  /* loops inside critical section         */
+  unsigned     writers;   /* percent of write locks for rwlock     */
+  unsigned     t_limit;   /* seconds to run or 0 for unlimited     */
+  unsigned     report;    /* report period in seconds              */
+} LL_OPTS;
+
+/* Every thread has own cache line, written only by the thread */
+typedef struct
+{
+  volatile unsigned long long ops;      /* operations done            */
+  unsigned                    sink;     /* result of critical work    */
+  unsigned                    index;    /* thread number              */
+  pthread_t                   thread;
+} __attribute__((aligned(LL_CACHE_LINE))) LL_WORKER;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static const char* primitive_names[] = { "unknown", "mutex", "spin", "rwlock", "atomic", "false", "padded" };
+
+static LL_OPTS      opts;
+static LL_WORKER*   workers;
+static volatile int done_flag;
+
+/* Contended data, every lock and the counter it protects share own line as
+   usual, the largest one (rwlock 56 bytes in glibc) fits with its counter */
+static struct
+{
+  LL_LOCKED(pthread_mutex_t)    mutex;
+  LL_LOCKED(pthread_spinlock_t) spin;
+  LL_LOCKED(pthread_rwlock_t)   rwlock;
+  volatile unsigned long long   counter __attribute__((aligned(LL_CACHE_LINE)));  /* atomic */
+} shared;
+
+_Static_assert(sizeof(shared.mutex) == LL_CACHE_LINE && sizeof(shared.spin) == LL_CACHE_LINE &&
+               sizeof(shared.rwlock) == LL_CACHE_LINE, "lock and its counter exceed one cache line");
+
+/* Counters of false mode, LL_CACHE_LINE / 8 threads per line */
+static volatile unsigned long long* packed;
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * ll_getprimitive -- returns primitive by name.
+ * parameters: name
+ * returns: primitive or LL_Unknown.
+ * ------------------------------------------------------------------------- */
+
+static LL_PRIMITIVE ll_getprimitive(const char* name)
+{
+  unsigned index;
+
+  for (index = 1; index < LL_CAPACITY(primitive_names); index++)
+    if (0 == strcmp(primitive_names[index], name))
+      return (LL_PRIMITIVE)index;
+
+  return LL_Unknown;
+} /* ll_getprimitive */
+
+/* ------------------------------------------------------------------------- *
+ * ll_work -- critical section body, dependent arithmetic.
+ * parameters: seed
+ * returns: result which shall be used by caller.
+ * ------------------------------------------------------------------------- */
+
+static unsigned ll_work(unsigned seed)
+{
+  unsigned loop;
+
+  for (loop = 0; loop < opts.critical; loop++)
+    seed = seed * 1103515245 + 12345;
+
+  return seed;
+} /* ll_work */
+
+/* ------------------------------------------------------------------------- *
+ * ll_thread -- contending thread.
+ * parameters: worker
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* ll_thread(void* arg)
+{
+  LL_WORKER* self = (LL_WORKER*)arg;
+  unsigned   seed = self->index + 1;
+
+  while (!done_flag)
+  {
+    switch (opts.primitive)
+    {
+      case LL_Mutex:
+        pthread_mutex_lock(&shared.mutex.lock);
+        seed = ll_work(seed);
+        shared.mutex.counter++;
+        pthread_mutex_unlock(&shared.mutex.lock);
+        break;
+
+      case LL_Spin:
+        pthread_spin_lock(&shared.spin.lock);
+        seed = ll_work(seed);
+        shared.spin.counter++;
+        pthread_spin_unlock(&shared.spin.lock);
+        break;
+
+      case LL_RWLock:
+        if ((seed >> 16) % 100 < opts.writers)
+        {
+          pthread_rwlock_wrlock(&shared.rwlock.lock);
+          seed = ll_work(seed);
+          shared.rwlock.counter++;
+        }
+        else
+        {
+          pthread_rwlock_rdlock(&shared.rwlock.lock);
+          seed = ll_work(seed) + (unsigned)shared.rwlock.counter;
+        }
+        pthread_rwlock_unlock(&shared.rwlock.lock);
+        /* new choice of writer also without critical section work */
+        seed = seed * 1103515245 + 12345;
+        break;
+
+      case LL_Atomic:
+        seed = ll_work(seed);
+        __atomic_fetch_add(&shared.counter, 1, __ATOMIC_SEQ_CST);
+        break;
+
+      case LL_False:
+        seed = ll_work(seed);
+        packed[self->index]++;
+        break;
+
+      default:
+        /* own cache line only */
+        seed = ll_work(seed);
+        break;
+    }
+
+    self->ops++;
+  }
+
+  /* keep the work from being optimized out */
+  self->sink = seed;
+  return NULL;
+} /* ll_thread */
+
+/* ------------------------------------------------------------------------- *
+ * ll_print -- print per-thread rates and fairness.
+ * parameters: time label, ops per thread, period in ns
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void ll_print(const char* when, const unsigned long long* ops, LH_NSEC period)
+{
+  long double sum = 0;
+  long double squares = 0;
+  unsigned long long min = ops[0];
+  unsigned long long max = ops[0];
+  unsigned index;
+
+  for (index = 0; index < opts.threads; index++)
+  {
+    sum     += ops[index];
+    squares += (long double)ops[index] * ops[index];
+    if (ops[index] < min)
+      min = ops[index];
+    if (ops[index] > max)
+      max = ops[index];
+  }
+
+  printf ("%s %.0f ops/s, per thread min %.0f avg %.0f max %.0f, fairness %.3f\n",
+          when, (double)(sum * 1e9 / period), min * 1e9 / period,
+          (double)(sum * 1e9 / period / opts.threads), max * 1e9 / period,
+          (double)(squares > 0 ? sum * sum / (opts.threads * squares) : 1.0));
+} /* ll_print */
+
+/* ------------------------------------------------------------------------- *
+ * ll_done_handler -- handler for termination signal.
+ * parameters: signal received
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void ll_done_handler(int signo)
+{
+  /* Make compiler happy */
+  signo = signo;
+  done_flag = 1;
+} /* ll_done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * ll_usage -- show usage of application
+ * parameters: application name
+ * returns: 1.
+ * ------------------------------------------------------------------------- */
+
+static int ll_usage(const char* self)
+{
+  printf ("\nUsage: %s [-t <threads>] [-c <loops>] [-w <percent>] [-d <secs>] [-i <secs>] <primitive>\n", self);
+  printf ("\nPrimitives:\n");
+  printf ("  mutex\t\tpthread mutex around shared counter update.\n");
+  printf ("  spin\t\tpthread spinlock around shared counter update.\n");
+  printf ("  rwlock\tpthread rwlock, writers update and readers read shared counter.\n");
+  printf ("  atomic\tatomic fetch-add on one shared cache line.\n");
+  printf ("  false\t\tper-thread counters packed into shared cache lines.\n");
+  printf ("  padded\tper-thread counters on own cache lines, no sharing.\n");
+  printf ("\nOptions:\n");
+  printf ("  -t\t\tnumber of threads, default is number of online CPUs.\n");
+  printf ("  -c\t\tcritical section length in arithmetic loops, default 0.\n");
+  printf ("  -w\t\tpercent of write locks for rwlock, default %u.\n", LL_WRITERS);
+  printf ("  -d\t\ttest duration in seconds, default is until terminated.\n");
+  printf ("  -i\t\treport period, default %u seconds.\n", LL_REPORT);
+  printf ("\nExample:\n");
+  printf ("  %s -t 8 -c 100 mutex\n", self);
+  printf ("  %s -t 8 false\n", self);
+  printf ("\n");
+  return 1;
+} /* ll_usage */
+
+/* ========================================================================= *
+ * Main function.
+ * ========================================================================= */
+
+int main(int argc, char* const argv[])
+{
+  unsigned long long* ops;
+  unsigned long long* prev;
+  LH_NSEC  started;
+  LH_NSEC  last;
+  unsigned index;
+  int      c;
+
+  printf ("lock contention load generator, build %s %s\n", __DATE__, __TIME__);
+
+  memset(&opts, 0, sizeof(opts));
+  opts.threads = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+  opts.writers = LL_WRITERS;
+  opts.report  = LL_REPORT;
+
+  opterr = 0;
+  while ((c = getopt(argc, argv, "t:c:w:d:i:")) != -1)
+  {
+    switch (c)
+    {
+      case 't':
+        opts.threads = strtoul(optarg, NULL, 0);
+        break;
+      case 'c':
+        opts.critical = strtoul(optarg, NULL, 0);
+        break;
+      case 'w':
+        opts.writers = strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        opts.t_limit = strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        opts.report = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        return ll_usage(argv[0]);
+    }
+  }
+
+  if (optind != argc - 1 || 0 == opts.threads || opts.writers > 100 || 0 == opts.report)
+    return ll_usage(argv[0]);
+
+  opts.primitive = ll_getprimitive(argv[optind]);
+  if (LL_Unknown == opts.primitive)
+    return ll_usage(argv[0]);
+
+  printf ("%u threads contending on %s, critical section %u loops", opts.threads, primitive_names[opts.primitive], opts.critical);
+  if (LL_RWLock == opts.primitive)
+    printf (", %u%% writers", opts.writers);
+  printf ("\n");
+
+  signal(SIGINT,  ll_done_handler);
+  signal(SIGTERM, ll_done_handler);
+
+  pthread_mutex_init(&shared.mutex.lock, NULL);
+  pthread_spin_init(&shared.spin.lock, PTHREAD_PROCESS_PRIVATE);
+  pthread_rwlock_init(&shared.rwlock.lock, NULL);
+
+  ops  = (unsigned long long*)calloc(opts.threads, sizeof(*ops));
+  prev = (unsigned long long*)calloc(opts.threads, sizeof(*prev));
+  if (posix_memalign((void**)&workers, LL_CACHE_LINE, opts.threads * sizeof(*workers)) ||
+      posix_memalign((void**)&packed, LL_CACHE_LINE, opts.threads * sizeof(*packed)) || NULL == ops || NULL == prev)
+  {
+    printf ("no memory available\n");
+    return 1;
+  }
+  memset(workers, 0, opts.threads * sizeof(*workers));
+  memset((void*)packed, 0, opts.threads * sizeof(*packed));
+
+  started = last = lh_now();
+  for (index = 0; index < opts.threads; index++)
+  {
+    workers[index].index = index;
+    if (pthread_create(&workers[index].thread, NULL, ll_thread, workers + index))
+    {
+      printf ("cannot create thread %u\n", index + 1);
+      return 1;
+    }
+  }
+
+  while (!done_flag)
+  {
+    LH_NSEC now;
+    char    when[32];
+
+    sleep(opts.report);
+    if (opts.t_limit && lh_now() - started >= opts.t_limit * 1000000000ULL)
+      done_flag = 1;
+
+    now = lh_now();
+    for (index = 0; index < opts.threads; index++)
+    {
+      const unsigned long long current = workers[index].ops;
+      ops[index]  = current - prev[index];
+      prev[index] = current;
+    }
+
+    snprintf(when, sizeof(when), "%7.1f s:", (now - started) / 1e9);
+    ll_print(when, ops, now - last);
+    fflush(stdout);
+    last = now;
+  }
+
+  for (index = 0; index < opts.threads; index++)
+    pthread_join(workers[index].thread, NULL);
+
+  last = lh_now();
+  for (index = 0; index < opts.threads; index++)
+  {
+    ops[index] = workers[index].ops;
+    printf ("thread %u: %llu ops, %.0f/s\n", index + 1, ops[index], ops[index] * 1e9 / (last - started));
+  }
+  ll_print("total:", ops, last - started);
+
+  return 0;
+} /* main */
+
+/* ========================================================================= *
+ *                    No more code in file lockload.c                        *
+ * ========================================================================= */
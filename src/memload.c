@@ -47,14 +47,25 @@
  * Includes
  * ========================================================================= */
 
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include "cgroup.h"
+#include "ctlsock.h"
+#include "notify.h"
+#include "perfctr.h"
+
 #define MINFO_MEMFREE "MemFree:"
 #define MINFO_BUFFERS "Buffers:"
 #define MINFO_CACHED  "Cached:"
@@ -65,13 +76,46 @@
 #define MINFO_CACHED_LEN  8
 #define MINFO_SWAPTOT_LEN 11
 
+/* Memory is allocated and released in chunks of 1 MB */
+#define CHUNK_SHIFT 20
+#define CHUNK_SIZE  (1 << CHUNK_SHIFT)
+
 /* Filling pages approach */
 enum FILL
 {
   FILL_FAST, FILL_RAND
 };
 
+static char**    s_chunks = NULL;  /* allocated chunks                       */
+static unsigned  s_slots = 0;      /* capacity of s_chunks                   */
+static unsigned  s_used = 0;       /* allocated chunks, i.e. megabytes       */
+static unsigned  s_target = 0;     /* megabytes wanted                       */
+static int       s_paused = 0;     /* target is not applied while paused     */
+static enum FILL s_fill = FILL_RAND;
+static CG_SET    s_cgroup;         /* own cgroup v2, empty path if none      */
+
+/* Leak simulation settings */
+static double    s_leak_rate = 0;  /* MB/s to grow or 0 if not leaking     */
+static double    s_leak_exp = 0;   /* percents rate grows every second      */
+static unsigned  s_leak_step = 1;  /* MB allocated in one timestamped step  */
+static unsigned  s_plateau = 0;    /* seconds at top before release or 0    */
+
+/* Compaction and THP counters reported around fragmentation */
+static const char* const s_vmstat_names[] =
+{
+  "compact_stall", "compact_fail", "compact_success",
+  "compact_migrate_scanned", "compact_free_scanned", "compact_isolated",
+  "thp_fault_alloc", "thp_fault_fallback"
+};
+#define VMSTAT_COUNT (sizeof(s_vmstat_names) / sizeof(*s_vmstat_names))
+#define VMSTAT_COMPACT_STALL   0
+#define VMSTAT_THP_ALLOC       6
+#define VMSTAT_THP_FALLBACK    7
+
+#define MAX_MAP_COUNT "/proc/sys/vm/max_map_count"
 
+
+/* leave_free and result are in megabytes */
 static unsigned calc_allocsize(const unsigned leave_free)
 {
   unsigned memfree = 0, buffers = 0, cached = 0;
@@ -113,11 +157,26 @@ static unsigned calc_allocsize(const unsigned leave_free)
   }
 
   fclose(meminfo);
-  if ( (leave_free >> 20) > (memfree+buffers+cached)/1024 )
+
+  /* inside a container memory.max is what can be used */
+  if ( s_cgroup.path[0] && cg_memory_limit(&s_cgroup) )
+  {
+    const unsigned long long available = cg_memory_available(&s_cgroup) >> 20;
+
+    printf ("cgroup %s memory.max is %llu MB, %llu MB available\n", s_cgroup.path,
+            cg_memory_limit(&s_cgroup) >> 20, available);
+    if ( available < (memfree+buffers+cached)/1024 )
+    {
+      memfree = (unsigned)(available << 10);
+      buffers = cached = 0;
+    }
+  }
+
+  if ( leave_free > (memfree+buffers+cached)/1024 )
   {
     return 0;
   }
-  else return (memfree+buffers+cached)/1024-(leave_free >> 20);
+  else return (memfree+buffers+cached)/1024-leave_free;
 }
 
 static int open_oom_adj(void)
@@ -156,18 +215,404 @@ static int set_oom_adj(int oom_adj)
 } /* set_oom_adj */
 
 
+static void fill_chunk(char* chunk)
+{
+  if (FILL_FAST == s_fill)
+  {
+    memset(chunk, 0x55, CHUNK_SIZE);
+  }
+  else
+  {
+    long int* r = (long int*)chunk;
+    unsigned  s = CHUNK_SIZE / sizeof(*r);
+    while (s-- > 0)
+    {
+      *r++ = random();
+    }
+  }
+} /* fill_chunk */
+
+/* grows or shrinks allocation chunk by chunk towards s_target,
+   returns 0 if target is reached or paused, -1 if allocation failed */
+static int mem_apply(void)
+{
+  while (!s_paused && s_used != s_target)
+  {
+    if (s_used < s_target)
+    {
+      char* chunk;
+
+      if (s_used == s_slots)
+      {
+        const unsigned slots = (s_target > 2 * s_slots ? s_target : 2 * s_slots);
+        char** chunks = (char**)realloc(s_chunks, slots * sizeof(*chunks));
+        if (NULL == chunks)
+          return -1;
+        s_chunks = chunks;
+        s_slots  = slots;
+      }
+
+      chunk = (char*)mmap(NULL, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (MAP_FAILED == (void*)chunk)
+        return -1;
+      fill_chunk(chunk);
+      s_chunks[s_used++] = chunk;
+    }
+    else
+    {
+      munmap(s_chunks[--s_used], CHUNK_SIZE);
+    }
+
+    /* commands are handled also in the middle of resize */
+    if (cs_active())
+      cs_poll(0);
+  }
+
+  return 0;
+} /* mem_apply */
+
+/* parses size with optional K, M, G or T suffix, megabytes by default,
+   returns 0 if parsed, -1 if the text is not a valid size */
+static int parse_size(const char* text, unsigned* result)
+{
+  char* end;
+  unsigned long long size;
+
+  if (!isdigit((unsigned char)text[0]))
+    return -1;
+  errno = 0;
+  size = strtoull(text, &end, 0);
+  if (errno || end == text)
+    return -1;
+
+  switch (*end)
+  {
+    case 'k': case 'K': size >>= 10; end++; break;
+    case 'm': case 'M': end++; break;
+    case 'g': case 'G': size <<= 10; end++; break;
+    case 't': case 'T': size <<= 20; end++; break;
+    default: break;
+  }
+  if (*end || size > UINT_MAX)
+    return -1;
+
+  *result = (unsigned)size;
+  return 0;
+} /* parse_size */
+
+static void control_handler(const char* command, char* reply, size_t size)
+{
+  char value[32];
+
+  if (1 == sscanf(command, " set size %31s", value))
+  {
+    unsigned target;
+
+    if (parse_size(value, &target) < 0)
+      snprintf(reply, size, "error: illegal size '%s', use <N>[K|M|G|T]", value);
+    else
+    {
+      s_target = target;
+      snprintf(reply, size, "ok");
+    }
+  }
+  else if (0 == strcmp(command, "pause"))
+  {
+    s_paused = 1;
+    snprintf(reply, size, "ok");
+  }
+  else if (0 == strcmp(command, "resume"))
+  {
+    s_paused = 0;
+    snprintf(reply, size, "ok");
+  }
+  else if (0 == strcmp(command, "stats"))
+  {
+    snprintf(reply, size, "size %u MB target %u MB paused %d fill %s",
+             s_used, s_target, s_paused, (FILL_FAST == s_fill ? "fast" : "rand"));
+  }
+  else
+    snprintf(reply, size, "error: unknown command, use 'set size <N>[K|M|G|T]', 'pause', 'resume' or 'stats'");
+} /* control_handler */
+
+/* returns CLOCK_MONOTONIC time in seconds */
+static double mono_now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+} /* mono_now */
+
+/* sleeps until the CLOCK_MONOTONIC moment, handling control commands */
+static void leak_wait(double deadline)
+{
+  double now;
+
+  while ((now = mono_now()) < deadline || s_paused)
+  {
+    if (cs_active())
+      cs_poll(s_paused ? -1 : (int)((deadline - now) * 1000) + 1);
+    else
+    {
+      const double rest = deadline - now;
+      struct timespec pause;
+
+      pause.tv_sec  = (time_t)rest;
+      pause.tv_nsec = (long)((rest - pause.tv_sec) * 1e9);
+      nanosleep(&pause, NULL);
+    }
+  }
+} /* leak_wait */
+
+/* prints footprint with monotonic (as in kernel log) and wall clock stamps */
+static void leak_report(const char* what, double started, double rate)
+{
+  struct timespec real;
+
+  clock_gettime(CLOCK_REALTIME, &real);
+  printf ("[%12.6f] %ld.%03ld +%.3f s: %s %u MB", mono_now(), (long)real.tv_sec,
+          real.tv_nsec / 1000000, mono_now() - started, what, s_used);
+  if (rate > 0)
+    printf (" at %.1f MB/s", rate);
+  printf ("\n");
+  fflush(stdout);
+} /* leak_report */
+
+/* grows footprint step by step up to the ceiling at leak rate,
+   returns 0 if ceiling is reached, -1 if allocation failed */
+static int leak_grow(unsigned ceiling)
+{
+  const double started = mono_now();
+  double rate = s_leak_rate;
+  double due  = started;
+
+  leak_report("leak start", started, rate);
+  while (s_used < ceiling)
+  {
+    const unsigned step = (ceiling - s_used < s_leak_step ? ceiling - s_used : s_leak_step);
+
+    due += step / rate;
+    if (s_paused)
+    {
+      leak_wait(due);
+      due = mono_now();
+    }
+    else
+      leak_wait(due);
+
+    s_target = s_used + step;
+    if (mem_apply() < 0)
+      return -1;
+
+    if (s_leak_exp > 0)
+      rate = s_leak_rate * pow(1.0 + s_leak_exp / 100.0, mono_now() - started);
+    leak_report("footprint", started, rate);
+  }
+
+  return 0;
+} /* leak_grow */
+
+/* reads selected /proc/vmstat counters, missing ones stay 0 */
+static void vmstat_read(unsigned long long values[VMSTAT_COUNT])
+{
+  FILE* vmstat = fopen("/proc/vmstat", "r");
+  char  line[128];
+  unsigned index;
+
+  memset(values, 0, VMSTAT_COUNT * sizeof(*values));
+  if (!vmstat)
+    return;
+
+  while (fgets(line, sizeof(line), vmstat))
+  {
+    for (index = 0; index < VMSTAT_COUNT; index++)
+    {
+      const size_t len = strlen(s_vmstat_names[index]);
+      if (0 == strncmp(line, s_vmstat_names[index], len) && ' ' == line[len])
+        values[index] = strtoull(line + len + 1, NULL, 10);
+    }
+  }
+  fclose(vmstat);
+} /* vmstat_read */
+
+/* prints /proc/buddyinfo and compaction counters (with deltas if given) */
+static void frag_report(const char* when, unsigned long long values[VMSTAT_COUNT],
+                        const unsigned long long* before)
+{
+  FILE* buddyinfo = fopen("/proc/buddyinfo", "r");
+  char  line[256];
+  unsigned index;
+
+  printf ("%s: /proc/buddyinfo\n", when);
+  while (buddyinfo && fgets(line, sizeof(line), buddyinfo))
+    printf ("%s:   %s", when, line);
+  if (buddyinfo)
+    fclose(buddyinfo);
+
+  vmstat_read(values);
+  printf ("%s: /proc/vmstat", when);
+  for (index = 0; index < VMSTAT_COUNT; index++)
+  {
+    printf (" %s %llu", s_vmstat_names[index], values[index]);
+    if (before)
+      printf (" (+%llu)", values[index] - before[index]);
+  }
+  printf ("\n");
+  fflush(stdout);
+} /* frag_report */
+
+/* every locked run of kept pages becomes a mapping of its own, checks
+   before filling that size MB fragmented so fit below vm.max_map_count,
+   returns 0 if they fit, -1 if not */
+static int fragment_lock_check(unsigned size, unsigned keep, unsigned drop)
+{
+  const unsigned long long pages = ((unsigned long long)size << CHUNK_SHIFT) / getpagesize();
+  unsigned long long limit = 0;
+  unsigned long long maps = 0;
+  unsigned long long runs;
+  FILE* fp;
+  int c;
+
+  fp = fopen(MAX_MAP_COUNT, "r");
+  if (NULL == fp || 1 != fscanf(fp, "%llu", &limit))
+    limit = 0;
+  if (fp)
+    fclose(fp);
+  if (0 == limit)
+    return 0;
+
+  fp = fopen("/proc/self/maps", "r");
+  while (fp && EOF != (c = getc(fp)))
+    maps += ('\n' == c);
+  if (fp)
+    fclose(fp);
+
+  /* runs are cut also at chunk borders, each is followed by a released gap */
+  runs = pages / (keep + drop) + 1 + size;
+  if (2 * runs + maps <= limit)
+    return 0;
+
+  printf ("cannot lock fragmented memory: %llu locked runs of %u pages need about %llu mappings,\n",
+          runs, keep, 2 * runs + maps);
+  printf ("%s allows %llu, use smaller size, longer keep:free runs or no -m\n", MAX_MAP_COUNT, limit);
+  return -1;
+} /* fragment_lock_check */
+
+/* releases drop pages after every keep pages in all chunks, optionally
+   locking the kept ones, returns number of released pages or -1 if
+   locking failed */
+static long long fragment(unsigned keep, unsigned drop, int lock)
+{
+  const unsigned pagesize = (unsigned)getpagesize();
+  const unsigned pages = CHUNK_SIZE / pagesize;
+  unsigned long long index = 0;
+  long long released = 0;
+  unsigned chunk;
+
+  for (chunk = 0; chunk < s_used; chunk++)
+  {
+    unsigned page = 0;
+
+    /* handle runs of pages with the same fate by one call */
+    while (page < pages)
+    {
+      const int free_run = ((index % (keep + drop)) >= keep);
+      unsigned run = 0;
+
+      while (page + run < pages && free_run == ((index + run) % (keep + drop) >= keep))
+        run++;
+
+      if (free_run)
+      {
+        madvise(s_chunks[chunk] + page * pagesize, run * pagesize, MADV_DONTNEED);
+        released += run;
+      }
+      else if (lock && mlock(s_chunks[chunk] + page * pagesize, run * pagesize) < 0)
+      {
+        /* partly locked memory would not be what is reported */
+        perror("mlock of kept pages failed");
+        return -1;
+      }
+
+      page  += run;
+      index += run;
+    }
+  }
+
+  return released;
+} /* fragment */
+
+/* faults in THP-advised region and reports how long it took */
+static void hugepage_probe(unsigned size)
+{
+  const size_t huge   = 2 << 20;
+  const size_t length = (size_t)size << 20;
+  const unsigned pagesize = (unsigned)getpagesize();
+  char* area = (char*)mmap(NULL, length + huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  unsigned long long before[VMSTAT_COUNT];
+  unsigned long long after[VMSTAT_COUNT];
+  char*  start;
+  size_t offset;
+  double spent;
+
+  if (MAP_FAILED == (void*)area)
+  {
+    perror("hugepage probe");
+    return;
+  }
+
+  /* align to huge page size so whole region can be backed by THP */
+  start = (char*)(((unsigned long)area + huge - 1) & ~(huge - 1));
+  madvise(start, length, MADV_HUGEPAGE);
+
+  vmstat_read(before);
+  spent = mono_now();
+  for (offset = 0; offset < length; offset += pagesize)
+    start[offset] = 0x55;
+  spent = mono_now() - spent;
+  vmstat_read(after);
+
+  printf ("hugepage probe: %u MB faulted in %.3f s (%.1f MB/s), thp_fault_alloc +%llu thp_fault_fallback +%llu compact_stall +%llu\n",
+          size, spent, (spent > 0 ? size / spent : 0.0),
+          after[VMSTAT_THP_ALLOC] - before[VMSTAT_THP_ALLOC],
+          after[VMSTAT_THP_FALLBACK] - before[VMSTAT_THP_FALLBACK],
+          after[VMSTAT_COMPACT_STALL] - before[VMSTAT_COMPACT_STALL]);
+  munmap(area, length + huge);
+} /* hugepage_probe */
+
 static int usage(const char *progname)
 {
-  printf ("\nUsage: %s [ -e ] [-f fast|rand] [-j <oom_adj>|inherit] [ -l ] <megabytes>\n", progname);
+  printf ("\nUsage: %s [ -c ] [ -e ] [-f fast|rand] [-j <oom_adj>|inherit] [ -S <socket> ]\n", progname);
+  printf ("       [ -R <fd> ] [ -P <pidfile> ] [ -g <MB/s> [ -x <%%> ] [ -k <MB> ] [ -t <secs> ] ]\n");
+  printf ("       [ -F <keep>:<free> [ -m ] [ -H <MB> ] ] [ -l ] <megabytes>\n");
   printf ("\nOptions:\n");
+  printf ("  -c\t\treport performance counters of the memory filling.\n");
   printf ("  -e\t\texit after consuming/dirtying the allocated memory.\n");
-  printf ("  -l\t\tthe given amount of RAM is left free instead of consumed.\n");
+  printf ("  -l\t\tthe given amount of RAM is left free instead of consumed,\n");
+  printf ("  \t\tinside cgroup v2 below its memory.max.\n");
   printf ("  -f\t\tfilling memory using 'rand' or 'fast' method.\n");
   printf ("  -j\t\tset oom_adj to specified value (default = 0) or inherit it.\n");
+  printf ("  -S\t\tcontrol socket accepting 'set size <N>[K|M|G|T]', 'pause',\n");
+  printf ("  \t\t'resume' and 'stats' line commands.\n");
+  printf ("  -R\t\twrite readiness line to inherited descriptor when memory is filled.\n");
+  printf ("  -P\t\tcreate pidfile when memory is filled.\n");
+  printf ("  \t\tREADY=1 is also sent to $NOTIFY_SOCKET if it is set.\n");
+  printf ("  -g\t\tsimulate a leak, grow up to the given size at given rate.\n");
+  printf ("  -x\t\tleak rate grows exponentially by given percents every second.\n");
+  printf ("  -k\t\tleak grows in steps of given size, default 1 MB.\n");
+  printf ("  -t\t\tafter reaching the size, hold it for given seconds, release\n");
+  printf ("  \t\tall and leak again. Default is to hold forever.\n");
+  printf ("  -F\t\tfragment physical memory: after filling, release <free> pages\n");
+  printf ("  \t\tafter every <keep> pages, e.g. 1:1 releases every other page.\n");
+  printf ("  -m\t\tmlock the kept pages of fragmented memory.\n");
+  printf ("  -H\t\tafter fragmenting, time faulting in given MB with MADV_HUGEPAGE.\n");
   printf ("\nExample:\n");
   printf ("  %s -e 20\n", progname);
   printf ("  %s -f fast -j inherit 20\n", progname);
   printf ("  %s -f fast -j -17 -l 20\n", progname);
+  printf ("  %s -g 4 -t 60 2048\n", progname);
+  printf ("  %s -F 1:1 -H 256 4096\n", progname);
   printf ("\n");
   return 1;
 }
@@ -178,26 +623,36 @@ int main(int argc, char * const argv[])
    opterr = 0;
    unsigned size = 0;
    unsigned leave_free;
+   const char* control = NULL;
+   const char* pidfile = NULL;
+   int ready_fd = -1;
    int exit_when_done = 0;
+   int counters = 0;
+   PC_SET pc;
+   unsigned frag_keep = 0, frag_free = 0, huge_probe = 0;
+   int frag_lock = 0;
    int cur_oom = get_oom_adj();
    int new_oom = 0;
-   void* data;
-   enum FILL fill = FILL_RAND;
 
    if (argc < 2)
      return usage(argv[0]);
 
-   while ((c = getopt(argc, argv, "el:f:j:")) != -1)
+   cg_open(&s_cgroup);
+
+   while ((c = getopt(argc, argv, "cel:f:j:S:R:P:g:x:k:t:F:mH:")) != -1)
    {
      switch(c)
      {
+       case 'c':
+          counters = 1;
+          break;
        case 'e':
           exit_when_done = 1;
           break;
        case 'l':
-         leave_free = strtoul(optarg, NULL, 0) << 20;
-         printf ("Should leave %u MB free\n", leave_free >> 20 );
-         size = calc_allocsize(leave_free) << 20;
+         leave_free = strtoul(optarg, NULL, 0);
+         printf ("Should leave %u MB free\n", leave_free );
+         size = calc_allocsize(leave_free);
          if (size == 0)
          {
             printf("Can't do this (too much memory already in use?)\n");
@@ -205,7 +660,42 @@ int main(int argc, char * const argv[])
          }
          break;
        case 'f':
-          fill = (0 == strcmp(optarg, "fast") ? FILL_FAST : FILL_RAND);
+          s_fill = (0 == strcmp(optarg, "fast") ? FILL_FAST : FILL_RAND);
+          break;
+       case 'S':
+          control = optarg;
+          break;
+       case 'R':
+          ready_fd = atoi(optarg);
+          break;
+       case 'P':
+          pidfile = optarg;
+          break;
+       case 'g':
+          s_leak_rate = atof(optarg);
+          if (s_leak_rate <= 0)
+            return usage(argv[0]);
+          break;
+       case 'x':
+          s_leak_exp = atof(optarg);
+          break;
+       case 'k':
+          s_leak_step = strtoul(optarg, NULL, 0);
+          if (0 == s_leak_step)
+            return usage(argv[0]);
+          break;
+       case 't':
+          s_plateau = strtoul(optarg, NULL, 0);
+          break;
+       case 'F':
+          if (2 != sscanf(optarg, "%u:%u", &frag_keep, &frag_free) || 0 == frag_keep || 0 == frag_free)
+            return usage(argv[0]);
+          break;
+       case 'm':
+          frag_lock = 1;
+          break;
+       case 'H':
+          huge_probe = strtoul(optarg, NULL, 0);
           break;
        case 'j':
           new_oom = (optarg && 0 == strcmp(optarg, "inherit") ? cur_oom : atoi(optarg));
@@ -215,49 +705,166 @@ int main(int argc, char * const argv[])
      }
    }
 
+  nt_setup(ready_fd, pidfile);
+
   /* The traditional mode */
   if (!size)
   {
     if (optind >= argc)
       return usage(argv[0]);
-    size = atoi(argv[optind]) << 20;
+    size = atoi(argv[optind]);
     if (size <= 0)
       return usage(argv[0]);
   }
 
+  if (s_cgroup.path[0] && cg_memory_limit(&s_cgroup) && size > (cg_memory_available(&s_cgroup) >> 20))
+  {
+    printf ("Warning: %u MB is more than available below memory.max of the cgroup,\n", size);
+    printf ("expect reclaim, swapping or OOM kill.\n");
+  }
+
   printf ("current oom_adj is set to %d\n", cur_oom);
   if (cur_oom != new_oom)
   {
     printf ("updating oom_adj to %d: %s\n", new_oom, (set_oom_adj(new_oom) ? "AJDUSTED" : "FAILED"));
   }
 
-  printf ("preparing data using %s filling method\n", (FILL_FAST == fill ? "FAST" : "RAND"));
-  data = malloc(size);
-  if ( data )
+  if (frag_keep && frag_lock && fragment_lock_check(size, frag_keep, frag_free) < 0)
+    return 1;
+
+  if (control && cs_open(control, control_handler) < 0)
+    return 1;
+
+  if (counters)
+    counters = pc_open(&pc);
+
+  printf ("preparing data using %s filling method\n", (FILL_FAST == s_fill ? "FAST" : "RAND"));
+  s_target = size;
+  nt_fill_start();
+  if ((s_leak_rate > 0 ? leak_grow(size) : mem_apply()) < 0)
+  {
+    printf ("jammed with %u MB\n", s_target);
+    cs_close();
+    return 0;
+  }
+
+  /* pause during the fill, readiness means the fill is complete */
+  if (s_used != s_target)
   {
-    if (FILL_FAST == fill)
+    printf ("paused with %u MB of %u MB, waiting for resume\n", s_used, s_target);
+    fflush(stdout);
+  }
+  while (s_used != s_target)
+  {
+    /* paused time is not fill time */
+    nt_fill_stop(s_used);
+    cs_poll(-1);
+    nt_fill_start();
+    if (mem_apply() < 0)
     {
-      memset(data, size, size | 0x55);
+      printf ("jammed with %u MB\n", s_target);
+      cs_close();
+      return 0;
     }
-    else
+  }
+
+  nt_fill_stop(s_used);
+  printf ("%u MB eat\n", s_used);
+  cg_sample(&s_cgroup);
+  cg_print(&s_cgroup, "fill:", 0);
+  if (counters)
+  {
+    pc_sample(&pc);
+    pc_print(&pc, "fill:");
+    pc_close(&pc);
+  }
+
+  if (frag_keep)
+  {
+    unsigned long long before[VMSTAT_COUNT];
+    unsigned long long after[VMSTAT_COUNT];
+    long long released;
+
+    frag_report("before", before, NULL);
+    released = fragment(frag_keep, frag_free, frag_lock);
+    if (released < 0)
     {
-      long int* r = (long int*)data;
-      unsigned  s = size / sizeof(*r);
-      while (s-- > 0)
-      {
-        *r++ = random();
-      }
+      cs_close();
+      return 1;
     }
-    printf ("%u MB eat\n", size >> 20);
+    printf ("fragmented: released %llu MB as %u of every %u pages%s\n",
+            (released * getpagesize()) >> 20, frag_free, frag_keep + frag_free,
+            (frag_lock ? ", kept pages locked" : ""));
+    frag_report("after", after, before);
 
-    if (exit_when_done)
-      return 0;
+    /* the load is in place, the probe only reports about it */
+    nt_ready(s_used - (unsigned)((released * getpagesize()) >> 20));
+    if (huge_probe)
+      hugepage_probe(huge_probe);
+  }
+  else
+    nt_ready(s_used);
+
+  if (exit_when_done)
+  {
+    cs_close();
+    return 0;
+  }
+
+  /* periodic release, plateau and leaking again */
+  while (s_leak_rate > 0 && s_plateau)
+  {
+    const double started = mono_now();
+
+    leak_report("plateau", started, 0);
+    leak_wait(started + s_plateau);
+    s_target = 0;
+    mem_apply();
+    leak_report("released", started, 0);
+    if (leak_grow(size) < 0)
+    {
+      printf ("jammed with %u MB\n", size);
+      break;
+    }
+  }
+
+  if (!cs_active())
+  {
     while (1)
+    {
+      unsigned index;
+      int      changed = 0;
+
+      /* pressure caused later by others is of interest as well */
       sleep(60);
+      cg_sample(&s_cgroup);
+      for (index = CG_THROTTLED; index < CG_COUNT; index++)
+        changed |= (0 != s_cgroup.delta[index]);
+      if (changed)
+      {
+        cg_print(&s_cgroup, "hold:", 0);
+        fflush(stdout);
+      }
+    }
   }
-  else
+
+  /* retargeting through control socket */
+  while (1)
   {
-    printf ("jammed with %u MB\n", size >> 20);
+    fflush(stdout);
+    cs_poll(-1);
+    if (s_used == s_target)
+      continue;
+
+    if (mem_apply() < 0)
+    {
+      printf ("jammed with %u MB, holding %u MB\n", s_target, s_used);
+      s_target = s_used;
+    }
+    else if (s_used == s_target)
+      printf ("%u MB eat\n", s_used);
+    cg_sample(&s_cgroup);
+    cg_print(&s_cgroup, "resize:", 0);
   }
 
   return 0;
@@ -0,0 +1,670 @@
+/* ========================================================================= *
+ * File: metaload.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Filesystem metadata load generator. Every thread owns a subtree of
+ *    directories with a rolling set of small files, and for every file in
+ *    turn does the next step of its life: create (with optional fsync),
+ *    stat, rename and unlink. So the mix of operations is even, the number
+ *    of live files is stable and inodes and dentries are churned at the
+ *    target rate. Per operation rates and latency percentiles and growth
+ *    of dentry and inode caches are reported periodically.
+ *
+ *    Examples:
+ *      metaload -t 8 /mnt/test - 8 threads as fast as possible
+ *      metaload -t 4 -r 20000 -n 100000 -f /var/tmp - fsync, 20000 ops/s
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lathist.h"
+
+/* ========================================================================= *
+ * General settings.
+ * ========================================================================= */
+
+#define MD_REPORT         5             /* Default report period, seconds      */
+#define MD_FILES          1000          /* Default live files per thread       */
+#define MD_DIRS           16            /* Default directories per thread      */
+#define MD_SIZE           512           /* Default file size, bytes            */
+#define MD_BACKLOG        1000000000ULL /* Schedule is reset if behind so much */
+#define MD_SLABINFO       "/proc/slabinfo"
+#define MD_DENTRY_STATE   "/proc/sys/fs/dentry-state"
+#define MD_INODE_NR       "/proc/sys/fs/inode-nr"
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+typedef enum
+{
+  MD_Create,          /* open(O_CREAT | O_EXCL), write, fsync, close */
+  MD_Stat,            /* fstatat()                                   */
+  MD_Rename,          /* renameat() within the directory             */
+  MD_Unlink,          /* unlinkat() of renamed file                  */
+  MD_OPS
+} MD_OP;
+
+typedef struct
+{
+  unsigned    threads;  /* number of threads                          */
+  unsigned    rate;     /* operations per second in total, 0 unlimited */
+  unsigned    files;    /* live files per thread                      */
+  unsigned    dirs;     /* directories per thread                     */
+  unsigned    size;     /* bytes written to every file                */
+  int         sync;     /* fsync files and directories                */
+  unsigned    t_limit;  /* seconds to run or 0 for unlimited          */
+  unsigned    report;   /* report period in seconds                   */
+  const char* root;     /* directory where the tree is created        */
+} MD_OPTS;
+
+typedef struct
+{
+  pthread_t          thread;
+  unsigned           index;        /* thread number                        */
+  int*               dirs;         /* descriptors of own directories       */
+  unsigned char*     state;        /* next operation for every file        */
+  pthread_mutex_t    lock;         /* protects the statistics below        */
+  LH_HIST            hist[MD_OPS]; /* latencies since last report          */
+  unsigned long long failed;       /* failed operations since last report  */
+} MD_WORKER;
+
+typedef struct
+{
+  unsigned long long dentries;     /* dentry objects                       */
+  unsigned long long inodes;       /* inode objects of all filesystems     */
+  unsigned long long bytes;        /* memory of both, 0 if not known       */
+} MD_CACHES;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static const char* op_names[MD_OPS] = { "create", "stat", "rename", "unlink" };
+
+static MD_OPTS      opts;
+static MD_WORKER*   workers;
+static char         tree[1024];    /* top of own tree */
+static volatile int done_flag;
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * md_caches -- read dentry and inode cache sizes.
+ * parameters: caches to fill
+ * returns: source of information.
+ * ------------------------------------------------------------------------- */
+
+static const char* md_caches(MD_CACHES* caches)
+{
+  FILE* fp = fopen(MD_SLABINFO, "r");
+  char  line[512];
+
+  memset(caches, 0, sizeof(*caches));
+
+  if (fp)
+  {
+    while ( fgets(line, sizeof(line), fp) )
+    {
+      char name[64];
+      unsigned long long active;
+      unsigned long long size;
+      size_t len;
+
+      if (3 != sscanf(line, "%63s %llu %*u %llu", name, &active, &size))
+        continue;
+
+      /* dentry and every <fs>_inode_cache or <fs>_inode */
+      len = strlen(name);
+      if ( !strcmp(name, "dentry") )
+        caches->dentries += active;
+      else if ((len > 12 && !strcmp(name + len - 12, "_inode_cache")) || !strcmp(name, "inode_cache") ||
+               (len > 6 && !strcmp(name + len - 6, "_inode")))
+        caches->inodes += active;
+      else
+        continue;
+      caches->bytes += active * size;
+    }
+    fclose(fp);
+    return "slabinfo";
+  }
+
+  /* unprivileged users can see object counts only */
+  fp = fopen(MD_DENTRY_STATE, "r");
+  if (fp)
+  {
+    if (1 != fscanf(fp, "%llu", &caches->dentries))
+      caches->dentries = 0;
+    fclose(fp);
+  }
+  fp = fopen(MD_INODE_NR, "r");
+  if (fp)
+  {
+    if (1 != fscanf(fp, "%llu", &caches->inodes))
+      caches->inodes = 0;
+    fclose(fp);
+  }
+
+  return "fs counters";
+} /* md_caches */
+
+/* ------------------------------------------------------------------------- *
+ * md_actual -- find the next operation from the file on disk, used after
+ *    a failure which may have been done anyway (e.g. only fsync failed).
+ * parameters: directory, original and renamed file names
+ * returns: operation which is valid next.
+ * ------------------------------------------------------------------------- */
+
+static MD_OP md_actual(int dir, const char* name, const char* renamed)
+{
+  struct stat st;
+
+  if (0 == fstatat(dir, name, &st, AT_SYMLINK_NOFOLLOW))
+    return MD_Stat;
+  if (0 == fstatat(dir, renamed, &st, AT_SYMLINK_NOFOLLOW))
+    return MD_Unlink;
+
+  return MD_Create;
+} /* md_actual */
+
+/* ------------------------------------------------------------------------- *
+ * md_step -- do the next operation for the file.
+ * parameters: worker, file number, data to write
+ * returns: operation done, MD_OPS if failed.
+ * ------------------------------------------------------------------------- */
+
+static MD_OP md_step(MD_WORKER* self, unsigned file, const char* data)
+{
+  const int   dir = self->dirs[file % opts.dirs];
+  const MD_OP op  = (MD_OP)self->state[file];
+  char        name[32];
+  char        renamed[32];
+  struct stat st;
+  int         fd;
+  int         result = 0;
+
+  snprintf(name,    sizeof(name),    "f%u", file);
+  snprintf(renamed, sizeof(renamed), "r%u", file);
+
+  switch (op)
+  {
+    case MD_Create:
+      fd = openat(dir, name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+      if (fd < 0)
+      {
+        self->state[file] = md_actual(dir, name, renamed);
+        return MD_OPS;
+      }
+      if (opts.size && write(fd, data, opts.size) != (ssize_t)opts.size)
+        result = -1;
+      if (opts.sync && fsync(fd) < 0)
+        result = -1;
+      close(fd);
+      break;
+
+    case MD_Stat:
+      result = fstatat(dir, name, &st, 0);
+      break;
+
+    case MD_Rename:
+      result = renameat(dir, name, dir, renamed);
+      break;
+
+    default:
+      result = unlinkat(dir, renamed, 0);
+      break;
+  }
+
+  /* directory entries are made durable too */
+  if (0 == result && opts.sync && MD_Stat != op)
+    result = fsync(dir);
+
+  if (result < 0)
+  {
+    self->state[file] = md_actual(dir, name, renamed);
+    return MD_OPS;
+  }
+
+  self->state[file] = (op + 1) % MD_OPS;
+  return op;
+} /* md_step */
+
+/* ------------------------------------------------------------------------- *
+ * md_worker -- thread doing operations according to schedule.
+ * parameters: worker
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* md_worker(void* arg)
+{
+  MD_WORKER* self = (MD_WORKER*)arg;
+  const LH_NSEC period = (opts.rate ? 1000000000ULL * opts.threads / opts.rate : 0);
+  LH_NSEC  due  = lh_now();
+  unsigned file = 0;
+  char*    data = (char*)malloc(opts.size + 1);
+
+  if (NULL == data)
+    return NULL;
+  memset(data, 0x55, opts.size + 1);
+
+  while (!done_flag)
+  {
+    LH_NSEC started;
+    MD_OP   op;
+
+    if (period)
+    {
+      struct timespec wake;
+
+      due += period;
+      wake.tv_sec  = due / 1000000000ULL;
+      wake.tv_nsec = due % 1000000000ULL;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+
+      /* do not try to catch up after long stalls */
+      if (lh_now() > due + MD_BACKLOG)
+        due = lh_now();
+    }
+
+    started = lh_now();
+    op      = md_step(self, file, data);
+    started = lh_now() - started;
+
+    pthread_mutex_lock(&self->lock);
+    if (MD_OPS == op)
+      self->failed++;
+    else
+      lh_add(self->hist + op, started);
+    pthread_mutex_unlock(&self->lock);
+
+    file = (file + 1) % opts.files;
+  }
+
+  free(data);
+  return NULL;
+} /* md_worker */
+
+/* ------------------------------------------------------------------------- *
+ * md_setup -- create directories of the worker.
+ * parameters: worker
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int md_setup(MD_WORKER* self)
+{
+  char     path[1280];
+  unsigned dir;
+
+  self->dirs  = (int*)malloc(opts.dirs * sizeof(*self->dirs));
+  self->state = (unsigned char*)calloc(opts.files, 1);
+  for (dir = 0; dir < opts.dirs && self->dirs; dir++)
+    self->dirs[dir] = -1;
+  if (NULL == self->dirs || NULL == self->state)
+  {
+    printf ("no memory available\n");
+    return -1;
+  }
+
+  snprintf(path, sizeof(path), "%s/t%u", tree, self->index);
+  if (mkdir(path, 0755) < 0)
+  {
+    printf ("cannot create %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  for (dir = 0; dir < opts.dirs; dir++)
+  {
+    snprintf(path, sizeof(path), "%s/t%u/d%u", tree, self->index, dir);
+    if (mkdir(path, 0755) < 0 || (self->dirs[dir] = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+    {
+      printf ("cannot create %s: %s\n", path, strerror(errno));
+      return -1;
+    }
+  }
+
+  pthread_mutex_init(&self->lock, NULL);
+  return 0;
+} /* md_setup */
+
+/* ------------------------------------------------------------------------- *
+ * md_cleanup -- remove files and directories of the worker.
+ * parameters: worker
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void md_cleanup(MD_WORKER* self)
+{
+  char     path[1280];
+  char     name[32];
+  unsigned file;
+  unsigned dir;
+
+  if (NULL == self->dirs)
+    return;
+
+  for (file = 0; file < opts.files && self->state; file++)
+  {
+    const int fd = self->dirs[file % opts.dirs];
+
+    if (fd < 0)
+      continue;
+
+    /* file has the original name until renamed */
+    snprintf(name, sizeof(name), (MD_Unlink == self->state[file] ? "r%u" : "f%u"), file);
+    if (MD_Create != self->state[file])
+      unlinkat(fd, name, 0);
+  }
+
+  for (dir = 0; dir < opts.dirs; dir++)
+  {
+    if (self->dirs[dir] >= 0)
+      close(self->dirs[dir]);
+    snprintf(path, sizeof(path), "%s/t%u/d%u", tree, self->index, dir);
+    rmdir(path);
+  }
+
+  snprintf(path, sizeof(path), "%s/t%u", tree, self->index);
+  rmdir(path);
+} /* md_cleanup */
+
+/* ------------------------------------------------------------------------- *
+ * md_collect -- collect and reset interval statistics of all workers.
+ * parameters: histograms to merge to, failures counter
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void md_collect(LH_HIST* hist, unsigned long long* failed)
+{
+  unsigned index;
+  unsigned op;
+
+  for (op = 0; op < MD_OPS; op++)
+    lh_init(hist + op);
+  *failed = 0;
+
+  for (index = 0; index < opts.threads; index++)
+  {
+    pthread_mutex_lock(&workers[index].lock);
+    for (op = 0; op < MD_OPS; op++)
+    {
+      lh_merge(hist + op, workers[index].hist + op);
+      lh_init(workers[index].hist + op);
+    }
+    *failed += workers[index].failed;
+    workers[index].failed = 0;
+    pthread_mutex_unlock(&workers[index].lock);
+  }
+} /* md_collect */
+
+/* ------------------------------------------------------------------------- *
+ * md_print -- print rates, latencies and cache growth.
+ * parameters: time label, histograms, failures, caches now and at start,
+ *             period in ns
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void md_print(const char* when, const LH_HIST* hist, unsigned long long failed,
+                     const MD_CACHES* now, const MD_CACHES* start, LH_NSEC period)
+{
+  unsigned long long total = 0;
+  unsigned op;
+
+  for (op = 0; op < MD_OPS; op++)
+    total += hist[op].count;
+
+  printf ("%s %.1f ops/s, failed %llu\n", when, total * 1e9 / period, failed);
+  for (op = 0; op < MD_OPS; op++)
+  {
+    char prefix[64];
+
+    snprintf(prefix, sizeof(prefix), "%s %-6s %.1f/s latency", when, op_names[op], hist[op].count * 1e9 / period);
+    lh_print(hist + op, prefix);
+  }
+
+  printf ("%s dentries %llu (%+lld), inodes %llu (%+lld)", when,
+          now->dentries, (long long)(now->dentries - start->dentries),
+          now->inodes, (long long)(now->inodes - start->inodes));
+  if (now->bytes)
+    printf (", slab %llu KB (%+lld KB)", now->bytes >> 10, ((long long)now->bytes - (long long)start->bytes) / 1024);
+  printf ("\n");
+} /* md_print */
+
+/* ------------------------------------------------------------------------- *
+ * md_done_handler -- handler for termination signal.
+ * parameters: signal received
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void md_done_handler(int signo)
+{
+  /* Make compiler happy */
+  signo = signo;
+  done_flag = 1;
+} /* md_done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * md_usage -- show usage of application
+ * parameters: application name
+ * returns: 1.
+ * ------------------------------------------------------------------------- */
+
+static int md_usage(const char* self)
+{
+  printf ("\nUsage: %s [-t <threads>] [-r <rate>] [-n <files>] [-D <dirs>] [-s <bytes>] [-f] [-d <secs>] [-i <secs>] <directory>\n", self);
+  printf ("\nEvery thread creates, stats, renames and unlinks its files in turn.\n");
+  printf ("\nOptions:\n");
+  printf ("  -t\t\tnumber of threads, default 1.\n");
+  printf ("  -r\t\toperations per second in total, default is unlimited.\n");
+  printf ("  -n\t\tfiles per thread, default %u.\n", MD_FILES);
+  printf ("  -D\t\tdirectories per thread, default %u.\n", MD_DIRS);
+  printf ("  -s\t\tbytes written to every file, default %u.\n", MD_SIZE);
+  printf ("  -f\t\tfsync created files and directories after every change.\n");
+  printf ("  -d\t\ttest duration in seconds, default is until terminated.\n");
+  printf ("  -i\t\treport period, default %u seconds.\n", MD_REPORT);
+  printf ("\nExample:\n");
+  printf ("  %s -t 8 /mnt/test\n", self);
+  printf ("  %s -t 4 -r 20000 -n 100000 -f /var/tmp\n", self);
+  printf ("\n");
+  return 1;
+} /* md_usage */
+
+/* ========================================================================= *
+ * Main function.
+ * ========================================================================= */
+
+int main(int argc, char* const argv[])
+{
+  LH_HIST   total[MD_OPS];
+  LH_HIST   interval[MD_OPS];
+  MD_CACHES start;
+  MD_CACHES caches;
+  const char* source;
+  LH_NSEC   started;
+  LH_NSEC   last;
+  unsigned long long failed;
+  unsigned long long total_failed = 0;
+  unsigned  index;
+  unsigned  op;
+  int       result = 0;
+  int       c;
+
+  printf ("filesystem metadata load generator, build %s %s\n", __DATE__, __TIME__);
+
+  memset(&opts, 0, sizeof(opts));
+  opts.threads = 1;
+  opts.files   = MD_FILES;
+  opts.dirs    = MD_DIRS;
+  opts.size    = MD_SIZE;
+  opts.report  = MD_REPORT;
+
+  opterr = 0;
+  while ((c = getopt(argc, argv, "t:r:n:D:s:fd:i:")) != -1)
+  {
+    switch (c)
+    {
+      case 't':
+        opts.threads = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        opts.rate = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        opts.files = strtoul(optarg, NULL, 0);
+        break;
+      case 'D':
+        opts.dirs = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        opts.size = strtoul(optarg, NULL, 0);
+        break;
+      case 'f':
+        opts.sync = 1;
+        break;
+      case 'd':
+        opts.t_limit = strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        opts.report = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        return md_usage(argv[0]);
+    }
+  }
+
+  if (optind != argc - 1 || 0 == opts.threads || 0 == opts.files || 0 == opts.dirs || 0 == opts.report)
+    return md_usage(argv[0]);
+  opts.root = argv[optind];
+
+  snprintf(tree, sizeof(tree), "%s/metaload.%u", opts.root, (unsigned)getpid());
+  if (mkdir(tree, 0755) < 0)
+  {
+    printf ("cannot create %s: %s\n", tree, strerror(errno));
+    return 1;
+  }
+
+  printf ("%u threads in %s, %u files in %u directories each, %u bytes%s",
+          opts.threads, tree, opts.files, opts.dirs, opts.size, (opts.sync ? " with fsync" : ""));
+  if (opts.rate)
+    printf (" at %u ops per second", opts.rate);
+  printf ("\n");
+
+  signal(SIGINT,  md_done_handler);
+  signal(SIGTERM, md_done_handler);
+
+  workers = (MD_WORKER*)calloc(opts.threads, sizeof(*workers));
+  if (NULL == workers)
+  {
+    printf ("no memory available\n");
+    rmdir(tree);
+    return 1;
+  }
+
+  for (index = 0; index < opts.threads && 0 == result; index++)
+  {
+    workers[index].index = index;
+    result = md_setup(workers + index);
+  }
+
+  source = md_caches(&start);
+  printf ("dentry and inode caches from %s\n", source);
+  for (op = 0; op < MD_OPS; op++)
+    lh_init(total + op);
+
+  started = last = lh_now();
+  for (index = 0; index < opts.threads && 0 == result; index++)
+  {
+    if (pthread_create(&workers[index].thread, NULL, md_worker, workers + index))
+    {
+      printf ("cannot create thread %u\n", index + 1);
+      result = -1;
+    }
+  }
+
+  /* threads which are started shall be stopped anyway */
+  if (result < 0)
+    done_flag = 1;
+
+  while (!done_flag)
+  {
+    LH_NSEC now;
+    char    when[32];
+
+    sleep(opts.report);
+    if (opts.t_limit && lh_now() - started >= opts.t_limit * 1000000000ULL)
+      done_flag = 1;
+
+    now = lh_now();
+    md_caches(&caches);
+    md_collect(interval, &failed);
+    for (op = 0; op < MD_OPS; op++)
+      lh_merge(total + op, interval + op);
+    total_failed += failed;
+
+    snprintf(when, sizeof(when), "%7.1f s:", (now - started) / 1e9);
+    md_print(when, interval, failed, &caches, &start, now - last);
+    fflush(stdout);
+    last = now;
+  }
+
+  for (index = 0; index < opts.threads; index++)
+    if (workers[index].thread)
+      pthread_join(workers[index].thread, NULL);
+
+  if (0 == result)
+  {
+    md_collect(interval, &failed);
+    for (op = 0; op < MD_OPS; op++)
+      lh_merge(total + op, interval + op);
+    total_failed += failed;
+
+    last = lh_now();
+    md_caches(&caches);
+    printf ("total: %.1f s\n", (last - started) / 1e9);
+    md_print("total:", total, total_failed, &caches, &start, last - started);
+  }
+
+  printf ("removing %s\n", tree);
+  for (index = 0; index < opts.threads; index++)
+    md_cleanup(workers + index);
+  rmdir(tree);
+
+  return (result < 0 ? 1 : 0);
+} /* main */
+
+/* ========================================================================= *
+ *                    No more code in file metaload.c                        *
+ * ========================================================================= */
@@ -0,0 +1,502 @@
+/* ========================================================================= *
+ * File: mmapload.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Address space modification load generator. Churn threads map a
+ *    region, touch all its pages, mprotect it read-only and unmap it at a
+ *    target rate, which takes mmap lock for writing and makes the kernel
+ *    flush TLBs of all CPUs running threads of the process. Fault threads
+ *    of the same process meanwhile drop their own region with
+ *    MADV_DONTNEED and write it again, so every page write is a page
+ *    fault which competes for the same lock. Fault regions are excluded
+ *    from transparent huge pages, so a fault maps one page only.
+ *    Churn rate and latency, fault latency and TLB shootdown interrupts
+ *    from /proc/interrupts are reported periodically.
+ *
+ *    Examples:
+ *      mmapload -t 4 -f 4 -r 20000 - 4 churn threads at 20000 ops/s total
+ *      mmapload -t 8 -s 2048 -f 2 -F 256 -d 60 - large regions, 60 seconds
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lathist.h"
+
+/* ========================================================================= *
+ * General settings.
+ * ========================================================================= */
+
+#define ML_REPORT         5             /* Default report period, seconds      */
+#define ML_CHURN_KB       256           /* Default churn region, kilobytes     */
+#define ML_FAULT_MB       64            /* Default fault region, megabytes     */
+#define ML_BACKLOG        1000000000ULL /* Schedule is reset if behind so much */
+#define ML_INTERRUPTS     "/proc/interrupts"
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+typedef struct
+{
+  unsigned    churners; /* number of churn threads                    */
+  unsigned    faulters; /* number of fault threads                    */
+  unsigned    rate;     /* churn operations per second, 0 unlimited   */
+  unsigned    churn_kb; /* size of churn region in kilobytes          */
+  unsigned    fault_mb; /* size of region of every fault thread in MB */
+  unsigned    t_limit;  /* seconds to run or 0 for unlimited          */
+  unsigned    report;   /* report period in seconds                   */
+} ML_OPTS;
+
+typedef struct
+{
+  pthread_t          thread;   /* churn or fault thread                */
+  pthread_mutex_t    lock;     /* protects the histogram and counters  */
+  LH_HIST            hist;     /* latencies since last report          */
+  unsigned long long failed;   /* failed operations since last report  */
+} ML_WORKER;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static ML_OPTS      opts;
+static ML_WORKER*   workers;    /* churners first, then faulters */
+static unsigned     pagesize;
+static volatile int done_flag;
+static int          tlb_known;  /* TLB line found in /proc/interrupts */
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * ml_shootdowns -- read TLB shootdown interrupts of all CPUs.
+ * parameters: nothing
+ * returns: sum of TLB line of /proc/interrupts, tlb_known is set if found.
+ * ------------------------------------------------------------------------- */
+
+static unsigned long long ml_shootdowns(void)
+{
+  FILE* fp = fopen(ML_INTERRUPTS, "r");
+  unsigned long long total = 0;
+  char* line = NULL;
+  size_t size = 0;
+
+  if ( !fp )
+    return 0;
+
+  /* line is long on big machines, one column per CPU */
+  while (getline(&line, &size, fp) > 0)
+  {
+    char* ptr = line + strspn(line, " ");
+
+    if ( !strncmp(ptr, "TLB:", 4) )
+    {
+      tlb_known = 1;
+      ptr += 4;
+      while (1)
+      {
+        char* end;
+        const unsigned long long value = strtoull(ptr, &end, 10);
+
+        if (end == ptr)
+          break;
+        total += value;
+        ptr = end;
+      }
+      break;
+    }
+  }
+
+  free(line);
+  fclose(fp);
+  return total;
+} /* ml_shootdowns */
+
+/* ------------------------------------------------------------------------- *
+ * ml_churn_op -- map, touch, protect and unmap one region.
+ * parameters: region size
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int ml_churn_op(size_t size)
+{
+  volatile char* data;
+  size_t offset;
+  void*  ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (MAP_FAILED == ptr)
+    return -1;
+
+  data = (volatile char*)ptr;
+  for (offset = 0; offset < size; offset += pagesize)
+    data[offset] = 1;
+
+  if (mprotect(ptr, size, PROT_READ) < 0)
+  {
+    munmap(ptr, size);
+    return -1;
+  }
+
+  return munmap(ptr, size);
+} /* ml_churn_op */
+
+/* ------------------------------------------------------------------------- *
+ * ml_churner -- churn thread, does operations according to schedule.
+ * parameters: worker
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* ml_churner(void* arg)
+{
+  ML_WORKER* self = (ML_WORKER*)arg;
+  const size_t  size   = (size_t)opts.churn_kb << 10;
+  const LH_NSEC period = (opts.rate ? 1000000000ULL * opts.churners / opts.rate : 0);
+  LH_NSEC due = lh_now();
+
+  while (!done_flag)
+  {
+    LH_NSEC started;
+    int     result;
+
+    if (period)
+    {
+      struct timespec wake;
+
+      due += period;
+      wake.tv_sec  = due / 1000000000ULL;
+      wake.tv_nsec = due % 1000000000ULL;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+
+      /* do not try to catch up after long stalls */
+      if (lh_now() > due + ML_BACKLOG)
+        due = lh_now();
+    }
+
+    started = lh_now();
+    result  = ml_churn_op(size);
+    started = lh_now() - started;
+
+    pthread_mutex_lock(&self->lock);
+    if (result < 0)
+      self->failed++;
+    else
+      lh_add(&self->hist, started);
+    pthread_mutex_unlock(&self->lock);
+  }
+
+  return NULL;
+} /* ml_churner */
+
+/* ------------------------------------------------------------------------- *
+ * ml_faulter -- fault thread, drops own region and writes it again.
+ * parameters: worker
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* ml_faulter(void* arg)
+{
+  ML_WORKER* self = (ML_WORKER*)arg;
+  const size_t size = (size_t)opts.fault_mb << 20;
+  volatile char* data = (volatile char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (MAP_FAILED == (void*)data)
+  {
+    printf ("no space available for %u MB fault region\n", opts.fault_mb);
+    return NULL;
+  }
+
+  /* huge page would map 512 pages at once and the rest touches would be
+     timed as faults while being plain writes; fails without THP support */
+  madvise((void*)data, size, MADV_NOHUGEPAGE);
+
+  while (!done_flag)
+  {
+    LH_HIST hist;
+    size_t  offset;
+
+    /* every next write is a fault on zero page */
+    if (madvise((void*)data, size, MADV_DONTNEED) < 0)
+    {
+      pthread_mutex_lock(&self->lock);
+      self->failed++;
+      pthread_mutex_unlock(&self->lock);
+      break;
+    }
+
+    /* collect locally, the region takes a while; only the first touch of
+       every page is done and timed, that is the fault */
+    lh_init(&hist);
+    for (offset = 0; offset < size && !done_flag; offset += pagesize)
+    {
+      const LH_NSEC started = lh_now();
+      data[offset] = 1;
+      lh_add(&hist, lh_now() - started);
+    }
+
+    pthread_mutex_lock(&self->lock);
+    lh_merge(&self->hist, &hist);
+    pthread_mutex_unlock(&self->lock);
+  }
+
+  munmap((void*)data, size);
+  return NULL;
+} /* ml_faulter */
+
+/* ------------------------------------------------------------------------- *
+ * ml_collect -- collect and reset interval statistics of workers.
+ * parameters: first worker, number of workers, histogram to merge to,
+ *             failures counter
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void ml_collect(ML_WORKER* first, unsigned count, LH_HIST* hist, unsigned long long* failed)
+{
+  unsigned index;
+
+  lh_init(hist);
+  *failed = 0;
+  for (index = 0; index < count; index++)
+  {
+    pthread_mutex_lock(&first[index].lock);
+    lh_merge(hist, &first[index].hist);
+    *failed += first[index].failed;
+    lh_init(&first[index].hist);
+    first[index].failed = 0;
+    pthread_mutex_unlock(&first[index].lock);
+  }
+} /* ml_collect */
+
+/* ------------------------------------------------------------------------- *
+ * ml_print -- print rate and latency of one kind of operation.
+ * parameters: time label, operation name, histogram, failures, period ns
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void ml_print(const char* when, const char* what, const LH_HIST* hist, unsigned long long failed, LH_NSEC period)
+{
+  char prefix[96];
+
+  snprintf(prefix, sizeof(prefix), "%s %s %.1f/s failed %llu latency",
+           when, what, (period ? hist->count * 1e9 / period : 0.0), failed);
+  lh_print(hist, prefix);
+} /* ml_print */
+
+/* ------------------------------------------------------------------------- *
+ * ml_done_handler -- handler for termination signal.
+ * parameters: signal received
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void ml_done_handler(int signo)
+{
+  /* Make compiler happy */
+  signo = signo;
+  done_flag = 1;
+} /* ml_done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * ml_usage -- show usage of application
+ * parameters: application name
+ * returns: 1.
+ * ------------------------------------------------------------------------- */
+
+static int ml_usage(const char* self)
+{
+  printf ("\nUsage: %s [-t <threads>] [-r <rate>] [-s <KB>] [-f <threads>] [-F <MB>] [-d <secs>] [-i <secs>]\n", self);
+  printf ("\nOptions:\n");
+  printf ("  -t\t\tnumber of churn threads, default 1.\n");
+  printf ("  -r\t\tchurn operations (mmap, touch, mprotect, munmap) per second\n");
+  printf ("  \t\tin total, default is unlimited.\n");
+  printf ("  -s\t\tsize of churn region, default %u KB.\n", ML_CHURN_KB);
+  printf ("  -f\t\tnumber of fault threads, default 1.\n");
+  printf ("  -F\t\tsize of region of every fault thread, default %u MB.\n", ML_FAULT_MB);
+  printf ("  -d\t\ttest duration in seconds, default is until terminated.\n");
+  printf ("  -i\t\treport period, default %u seconds.\n", ML_REPORT);
+  printf ("\nExample:\n");
+  printf ("  %s -t 4 -f 4 -r 20000\n", self);
+  printf ("  %s -t 8 -s 2048 -f 2 -F 256 -d 60\n", self);
+  printf ("\n");
+  return 1;
+} /* ml_usage */
+
+/* ========================================================================= *
+ * Main function.
+ * ========================================================================= */
+
+int main(int argc, char* const argv[])
+{
+  LH_HIST  churn_total;
+  LH_HIST  fault_total;
+  LH_HIST  interval;
+  LH_NSEC  started;
+  LH_NSEC  last;
+  unsigned long long failed;
+  unsigned long long churn_failed = 0;
+  unsigned long long fault_failed = 0;
+  unsigned long long tlb_start;
+  unsigned long long tlb_last;
+  unsigned index;
+  int      c;
+
+  printf ("address space modification load generator, build %s %s\n", __DATE__, __TIME__);
+
+  memset(&opts, 0, sizeof(opts));
+  opts.churners = 1;
+  opts.faulters = 1;
+  opts.churn_kb = ML_CHURN_KB;
+  opts.fault_mb = ML_FAULT_MB;
+  opts.report   = ML_REPORT;
+  pagesize = (unsigned)getpagesize();
+
+  opterr = 0;
+  while ((c = getopt(argc, argv, "t:r:s:f:F:d:i:")) != -1)
+  {
+    switch (c)
+    {
+      case 't':
+        opts.churners = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        opts.rate = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        opts.churn_kb = strtoul(optarg, NULL, 0);
+        break;
+      case 'f':
+        opts.faulters = strtoul(optarg, NULL, 0);
+        break;
+      case 'F':
+        opts.fault_mb = strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        opts.t_limit = strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        opts.report = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        return ml_usage(argv[0]);
+    }
+  }
+
+  if (optind != argc || 0 == opts.churners + opts.faulters || 0 == opts.churn_kb || 0 == opts.fault_mb || 0 == opts.report)
+    return ml_usage(argv[0]);
+
+  printf ("%u churn threads with %u KB regions", opts.churners, opts.churn_kb);
+  if (opts.rate)
+    printf (" at %u per second", opts.rate);
+  printf (", %u fault threads with %u MB regions\n", opts.faulters, opts.fault_mb);
+
+  signal(SIGINT,  ml_done_handler);
+  signal(SIGTERM, ml_done_handler);
+
+  workers = (ML_WORKER*)calloc(opts.churners + opts.faulters, sizeof(*workers));
+  if (NULL == workers)
+  {
+    printf ("no memory available\n");
+    return 1;
+  }
+
+  lh_init(&churn_total);
+  lh_init(&fault_total);
+  tlb_start = tlb_last = ml_shootdowns();
+  started = last = lh_now();
+  for (index = 0; index < opts.churners + opts.faulters; index++)
+  {
+    pthread_mutex_init(&workers[index].lock, NULL);
+    lh_init(&workers[index].hist);
+    if (pthread_create(&workers[index].thread, NULL,
+                       (index < opts.churners ? ml_churner : ml_faulter), workers + index))
+    {
+      printf ("cannot create thread %u\n", index + 1);
+      return 1;
+    }
+  }
+
+  while (!done_flag)
+  {
+    unsigned long long tlb;
+    LH_NSEC now;
+    char    when[32];
+
+    sleep(opts.report);
+    tlb = ml_shootdowns();
+    if (opts.t_limit && lh_now() - started >= opts.t_limit * 1000000000ULL)
+      done_flag = 1;
+
+    now = lh_now();
+    snprintf(when, sizeof(when), "%7.1f s:", (now - started) / 1e9);
+
+    ml_collect(workers, opts.churners, &interval, &failed);
+    lh_merge(&churn_total, &interval);
+    churn_failed += failed;
+    ml_print(when, "churn", &interval, failed, now - last);
+
+    ml_collect(workers + opts.churners, opts.faulters, &interval, &failed);
+    lh_merge(&fault_total, &interval);
+    fault_failed += failed;
+    ml_print(when, "fault", &interval, failed, now - last);
+
+    if (tlb_known)
+      printf ("%s tlb shootdowns %llu, %.1f/s\n", when, tlb - tlb_last, (tlb - tlb_last) * 1e9 / (now - last));
+    else
+      printf ("%s tlb shootdowns n/a\n", when);
+    fflush(stdout);
+    tlb_last = tlb;
+    last = now;
+  }
+
+  for (index = 0; index < opts.churners + opts.faulters; index++)
+    pthread_join(workers[index].thread, NULL);
+
+  ml_collect(workers, opts.churners, &interval, &failed);
+  lh_merge(&churn_total, &interval);
+  churn_failed += failed;
+  ml_collect(workers + opts.churners, opts.faulters, &interval, &failed);
+  lh_merge(&fault_total, &interval);
+  fault_failed += failed;
+
+  last = lh_now();
+  tlb_last = ml_shootdowns();
+  printf ("total: %.1f s\n", (last - started) / 1e9);
+  ml_print("total:", "churn", &churn_total, churn_failed, last - started);
+  ml_print("total:", "fault", &fault_total, fault_failed, last - started);
+  if (tlb_known)
+    printf ("total: tlb shootdowns %llu, %.1f/s\n", tlb_last - tlb_start, (tlb_last - tlb_start) * 1e9 / (last - started));
+
+  return 0;
+} /* main */
+
+/* ========================================================================= *
+ *                    No more code in file mmapload.c                        *
+ * ========================================================================= */
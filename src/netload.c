@@ -0,0 +1,889 @@
+/* ========================================================================= *
+ * File: netload.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Loopback network load generator. Every connection has a sender and
+ *    a receiver thread in this process, connected over TCP or UDP on
+ *    127.0.0.1 or over UNIX stream socket pair, so no external network
+ *    is needed but the whole socket and loopback stack including softirq
+ *    processing is exercised. Messages are streamed, or echoed back by
+ *    the receiver to measure round trip time. Sender can use plain send,
+ *    MSG_ZEROCOPY, sendfile from memfd or vmsplice and splice through pipe.
+ *    Throughput, messages per second and round trip percentiles are
+ *    reported periodically.
+ *
+ *    Examples:
+ *      netload -c 4 -m 65536 tcp - 4 TCP streams as fast as possible
+ *      netload -e -m 64 -r 10000 udp - UDP request-response at 10k/s
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lathist.h"
+
+/* ========================================================================= *
+ * General settings.
+ * ========================================================================= */
+
+#define NL_REPORT         5             /* Default report period, seconds      */
+#define NL_SIZE           16384         /* Default message size, bytes         */
+#define NL_UDP_MAX        65507         /* Largest UDP payload over IPv4       */
+#define NL_BACKLOG        1000000000ULL /* Schedule is reset if behind so much */
+#define NL_UDP_TIMEOUT    1             /* Seconds to wait for UDP echo        */
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY       60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY      0x4000000
+#endif
+
+#define NL_CAPACITY(a)    (sizeof(a) / sizeof(*a))
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+typedef enum
+{
+  NL_Unknown,
+  NL_Tcp,
+  NL_Udp,
+  NL_Unix
+} NL_PROTO;
+
+typedef enum
+{
+  NL_Copy,            /* send()                          */
+  NL_ZeroCopy,        /* send() with MSG_ZEROCOPY        */
+  NL_Sendfile,        /* sendfile() from memfd           */
+  NL_Splice           /* vmsplice() to pipe and splice() */
+} NL_METHOD;
+
+typedef struct
+{
+  NL_PROTO    proto;    /* transport                                  */
+  NL_METHOD   method;   /* how the sender passes data to the socket   */
+  unsigned    conns;    /* number of connections                      */
+  unsigned    size;     /* message size in bytes                      */
+  unsigned    rate;     /* messages per second per connection or 0    */
+  int         echo;     /* receiver echoes every message back         */
+  unsigned    t_limit;  /* seconds to run or 0 for unlimited          */
+  unsigned    report;   /* report period in seconds                   */
+} NL_OPTS;
+
+typedef struct
+{
+  int                client;   /* sender socket                        */
+  int                server;   /* receiver socket                      */
+  int                file;     /* memfd with message for sendfile      */
+  int                pipe[2];  /* pipe for splice                      */
+  pthread_t          threads[2];
+  pthread_mutex_t    lock;     /* protects the counters below          */
+  LH_HIST            hist;     /* round trips since last report        */
+  unsigned long long tx;       /* bytes sent                           */
+  unsigned long long rx;       /* bytes received by receiver           */
+  unsigned long long failed;   /* failed sends and lost echoes         */
+  unsigned long long zc_done;  /* completed zero-copy sends            */
+  unsigned long long zc_copied;/* zero-copy sends which were copied    */
+} NL_CONN;
+
+typedef struct
+{
+  LH_HIST            hist;
+  unsigned long long tx;
+  unsigned long long rx;
+  unsigned long long failed;
+  unsigned long long zc_done;
+  unsigned long long zc_copied;
+} NL_STATS;
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static const char* proto_names[]  = { "unknown", "tcp", "udp", "unix" };
+static const char* method_names[] = { "copy", "zerocopy", "sendfile", "splice" };
+
+static NL_OPTS      opts;
+static NL_CONN*     conns;
+static volatile int done_flag;
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * nl_lookup -- returns index of name in the table.
+ * parameters: table, its size, name
+ * returns: index or -1 if not found.
+ * ------------------------------------------------------------------------- */
+
+static int nl_lookup(const char* const* table, unsigned size, const char* name)
+{
+  unsigned index;
+
+  for (index = 0; index < size; index++)
+    if (0 == strcmp(table[index], name))
+      return (int)index;
+
+  return -1;
+} /* nl_lookup */
+
+/* ------------------------------------------------------------------------- *
+ * nl_reap -- collect zero-copy completions from error queue.
+ * parameters: connection
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void nl_reap(NL_CONN* conn)
+{
+  while (1)
+  {
+    char            control[128];
+    struct msghdr   msg;
+    struct cmsghdr* cmsg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(conn->client, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+      return;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+      const struct sock_extended_err* serr = (const struct sock_extended_err*)CMSG_DATA(cmsg);
+      unsigned count;
+
+      if ((SOL_IP != cmsg->cmsg_level || IP_RECVERR != cmsg->cmsg_type) || SO_EE_ORIGIN_ZEROCOPY != serr->ee_origin)
+        continue;
+
+      /* notifications of sends ee_info..ee_data are coalesced */
+      count = serr->ee_data - serr->ee_info + 1;
+      pthread_mutex_lock(&conn->lock);
+      conn->zc_done += count;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        conn->zc_copied += count;
+      pthread_mutex_unlock(&conn->lock);
+    }
+  }
+} /* nl_reap */
+
+/* ------------------------------------------------------------------------- *
+ * nl_send_plain -- send whole buffer with send().
+ * parameters: socket, buffer, length, flags
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int nl_send_plain(int fd, const char* buf, size_t len, int flags)
+{
+  size_t done = 0;
+
+  while (done < len)
+  {
+    const ssize_t sent = send(fd, buf + done, len - done, flags | MSG_NOSIGNAL);
+
+    if (sent < 0)
+    {
+      if (EINTR == errno)
+        continue;
+      return -1;
+    }
+    done += sent;
+  }
+
+  return 0;
+} /* nl_send_plain */
+
+/* ------------------------------------------------------------------------- *
+ * nl_send -- send one message with selected method.
+ * parameters: connection, buffer
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int nl_send(NL_CONN* conn, const char* buf)
+{
+  const size_t len = opts.size;
+  size_t done = 0;
+
+  switch (opts.method)
+  {
+    case NL_ZeroCopy:
+      while (done < len)
+      {
+        const ssize_t sent = send(conn->client, buf + done, len - done, MSG_ZEROCOPY | MSG_NOSIGNAL);
+
+        if (sent < 0)
+        {
+          /* too many pending notifications */
+          if (ENOBUFS == errno)
+          {
+            struct pollfd pfd = { conn->client, 0, 0 };
+            poll(&pfd, 1, 10);
+            nl_reap(conn);
+            continue;
+          }
+          if (EINTR == errno)
+            continue;
+          return -1;
+        }
+        done += sent;
+      }
+      nl_reap(conn);
+      return 0;
+
+    case NL_Sendfile:
+      {
+        off_t offset = 0;
+
+        while ((size_t)offset < len)
+          if (sendfile(conn->client, conn->file, &offset, len - offset) < 0 && EINTR != errno)
+            return -1;
+      }
+      return 0;
+
+    case NL_Splice:
+      while (done < len)
+      {
+        struct iovec iov;
+        ssize_t      moved;
+
+        iov.iov_base = (void*)(buf + done);
+        iov.iov_len  = len - done;
+        moved = vmsplice(conn->pipe[1], &iov, 1, 0);
+        if (moved < 0)
+        {
+          if (EINTR == errno)
+            continue;
+          return -1;
+        }
+        done += moved;
+
+        /* drain the pipe into socket, the end of message is not corked */
+        while (moved > 0)
+        {
+          const ssize_t out = splice(conn->pipe[0], NULL, conn->client, NULL, moved,
+                                     SPLICE_F_MOVE | (done < len ? SPLICE_F_MORE : 0));
+
+          if (out < 0)
+          {
+            if (EINTR == errno)
+              continue;
+            return -1;
+          }
+          moved -= out;
+        }
+      }
+      return 0;
+
+    default:
+      return nl_send_plain(conn->client, buf, len, 0);
+  }
+} /* nl_send */
+
+/* ------------------------------------------------------------------------- *
+ * nl_recv -- receive one message, whole one for stream sockets.
+ * parameters: socket, buffer
+ * returns: bytes received, 0 at end or -1 if failed.
+ * ------------------------------------------------------------------------- */
+
+static ssize_t nl_recv(int fd, char* buf)
+{
+  size_t done = 0;
+
+  if (NL_Udp == opts.proto)
+    return recv(fd, buf, opts.size, 0);
+
+  while (done < opts.size)
+  {
+    const ssize_t got = recv(fd, buf + done, opts.size - done, 0);
+
+    if (got < 0 && EINTR == errno)
+      continue;
+    if (got <= 0)
+      return got;
+    done += got;
+  }
+
+  return done;
+} /* nl_recv */
+
+/* ------------------------------------------------------------------------- *
+ * nl_sender -- sender thread, sends messages according to schedule.
+ * parameters: connection
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* nl_sender(void* arg)
+{
+  NL_CONN* conn = (NL_CONN*)arg;
+  const LH_NSEC period = (opts.rate ? 1000000000ULL / opts.rate : 0);
+  LH_NSEC due = lh_now();
+  char*   buf = (char*)malloc(opts.size);
+
+  if (NULL == buf)
+    return NULL;
+  memset(buf, 0x55, opts.size);
+
+  while (!done_flag)
+  {
+    LH_NSEC started;
+    int     lost = 0;
+
+    if (period)
+    {
+      struct timespec wake;
+
+      due += period;
+      wake.tv_sec  = due / 1000000000ULL;
+      wake.tv_nsec = due % 1000000000ULL;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+
+      /* do not try to catch up after long stalls */
+      if (lh_now() > due + NL_BACKLOG)
+        due = lh_now();
+    }
+
+    started = lh_now();
+    if (nl_send(conn, buf) < 0)
+    {
+      if ( !done_flag )
+      {
+        printf ("send failed: %s\n", strerror(errno));
+        pthread_mutex_lock(&conn->lock);
+        conn->failed++;
+        pthread_mutex_unlock(&conn->lock);
+      }
+      break;
+    }
+
+    /* UDP echo can be dropped, recv times out then */
+    if (opts.echo && nl_recv(conn->client, buf) <= 0)
+    {
+      if (done_flag)
+        break;
+      lost = 1;
+    }
+
+    started = lh_now() - started;
+    pthread_mutex_lock(&conn->lock);
+    conn->tx += opts.size;
+    if (lost)
+      conn->failed++;
+    else if (opts.echo)
+      lh_add(&conn->hist, started);
+    pthread_mutex_unlock(&conn->lock);
+  }
+
+  free(buf);
+  return NULL;
+} /* nl_sender */
+
+/* ------------------------------------------------------------------------- *
+ * nl_receiver -- receiver thread, counts messages and echoes them.
+ * parameters: connection
+ * returns: NULL.
+ * ------------------------------------------------------------------------- */
+
+static void* nl_receiver(void* arg)
+{
+  NL_CONN* conn = (NL_CONN*)arg;
+  char*    buf  = (char*)malloc(opts.size);
+
+  if (NULL == buf)
+    return NULL;
+
+  while (1)
+  {
+    ssize_t got;
+
+    /* streams are read as they come unless message is echoed */
+    if (opts.echo || NL_Udp == opts.proto)
+      got = nl_recv(conn->server, buf);
+    else
+      got = recv(conn->server, buf, opts.size, 0);
+
+    if (got < 0 && EINTR == errno)
+      continue;
+    if (got <= 0)
+      break;
+
+    if (opts.echo && nl_send_plain(conn->server, buf, got, 0) < 0)
+      break;
+
+    pthread_mutex_lock(&conn->lock);
+    conn->rx += got;
+    pthread_mutex_unlock(&conn->lock);
+  }
+
+  free(buf);
+  return NULL;
+} /* nl_receiver */
+
+/* ------------------------------------------------------------------------- *
+ * nl_listen -- create TCP listening socket on loopback.
+ * parameters: address to fill with bound port
+ * returns: socket or -1.
+ * ------------------------------------------------------------------------- */
+
+static int nl_listen(struct sockaddr_in* addr)
+{
+  socklen_t len = sizeof(*addr);
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family      = AF_INET;
+  addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if (fd < 0 || bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0 ||
+      listen(fd, opts.conns) < 0 || getsockname(fd, (struct sockaddr*)addr, &len) < 0)
+  {
+    printf ("cannot listen on loopback: %s\n", strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+
+  return fd;
+} /* nl_listen */
+
+/* ------------------------------------------------------------------------- *
+ * nl_udp_pair -- create two UDP sockets on loopback connected to each other.
+ * parameters: sockets to fill
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int nl_udp_pair(int fds[2])
+{
+  struct sockaddr_in addr[2];
+  unsigned index;
+
+  for (index = 0; index < 2; index++)
+  {
+    socklen_t len = sizeof(addr[index]);
+
+    memset(addr + index, 0, sizeof(addr[index]));
+    addr[index].sin_family      = AF_INET;
+    addr[index].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fds[index] = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fds[index] < 0 || bind(fds[index], (struct sockaddr*)(addr + index), sizeof(addr[index])) < 0 ||
+        getsockname(fds[index], (struct sockaddr*)(addr + index), &len) < 0)
+      return -1;
+  }
+
+  if (connect(fds[0], (struct sockaddr*)(addr + 1), sizeof(addr[1])) < 0 ||
+      connect(fds[1], (struct sockaddr*)(addr + 0), sizeof(addr[0])) < 0)
+    return -1;
+
+  return 0;
+} /* nl_udp_pair */
+
+/* ------------------------------------------------------------------------- *
+ * nl_setup -- create sockets and helpers of every connection.
+ * parameters: nothing
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int nl_setup(void)
+{
+  struct sockaddr_in addr;
+  int      listener = -1;
+  unsigned index;
+
+  if (NL_Tcp == opts.proto && (listener = nl_listen(&addr)) < 0)
+    return -1;
+
+  for (index = 0; index < opts.conns; index++)
+  {
+    NL_CONN* conn = conns + index;
+    int      fds[2] = { -1, -1 };
+    int      result = 0;
+    const int one = 1;
+
+    switch (opts.proto)
+    {
+      case NL_Tcp:
+        fds[0] = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fds[0] < 0 || connect(fds[0], (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+            (fds[1] = accept4(listener, NULL, NULL, SOCK_CLOEXEC)) < 0)
+          result = -1;
+        else if (opts.echo)
+        {
+          setsockopt(fds[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          setsockopt(fds[1], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        break;
+
+      case NL_Udp:
+        result = nl_udp_pair(fds);
+        break;
+
+      default:
+        result = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+        break;
+    }
+
+    if (result < 0)
+    {
+      printf ("cannot create %s connection %u: %s\n", proto_names[opts.proto], index + 1, strerror(errno));
+      return -1;
+    }
+
+    conn->client  = fds[0];
+    conn->server  = fds[1];
+    conn->file    = -1;
+    conn->pipe[0] = conn->pipe[1] = -1;
+    pthread_mutex_init(&conn->lock, NULL);
+    lh_init(&conn->hist);
+
+    if (NL_Udp == opts.proto && opts.echo)
+    {
+      const struct timeval timeout = { NL_UDP_TIMEOUT, 0 };
+      setsockopt(conn->client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    switch (opts.method)
+    {
+      case NL_ZeroCopy:
+        result = setsockopt(conn->client, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+        break;
+
+      case NL_Sendfile:
+        {
+          char* buf = (char*)malloc(opts.size);
+
+          conn->file = memfd_create("netload", MFD_CLOEXEC);
+          result = -1;
+          if (buf && conn->file >= 0)
+          {
+            memset(buf, 0x55, opts.size);
+            if (pwrite(conn->file, buf, opts.size, 0) == (ssize_t)opts.size)
+              result = 0;
+          }
+          free(buf);
+        }
+        break;
+
+      case NL_Splice:
+        result = pipe2(conn->pipe, O_CLOEXEC);
+        /* whole message fits to the pipe if permitted */
+        if (0 == result)
+          fcntl(conn->pipe[1], F_SETPIPE_SZ, opts.size);
+        break;
+
+      default:
+        break;
+    }
+
+    if (result < 0)
+    {
+      printf ("cannot prepare %s sending: %s\n", method_names[opts.method], strerror(errno));
+      return -1;
+    }
+  }
+
+  if (listener >= 0)
+    close(listener);
+  return 0;
+} /* nl_setup */
+
+/* ------------------------------------------------------------------------- *
+ * nl_collect -- collect and reset interval statistics of all connections.
+ * parameters: statistics to fill
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void nl_collect(NL_STATS* stats)
+{
+  unsigned index;
+
+  memset(stats, 0, sizeof(*stats));
+  lh_init(&stats->hist);
+  for (index = 0; index < opts.conns; index++)
+  {
+    NL_CONN* conn = conns + index;
+
+    pthread_mutex_lock(&conn->lock);
+    lh_merge(&stats->hist, &conn->hist);
+    stats->tx        += conn->tx;
+    stats->rx        += conn->rx;
+    stats->failed    += conn->failed;
+    stats->zc_done   += conn->zc_done;
+    stats->zc_copied += conn->zc_copied;
+    lh_init(&conn->hist);
+    conn->tx = conn->rx = conn->failed = conn->zc_done = conn->zc_copied = 0;
+    pthread_mutex_unlock(&conn->lock);
+  }
+} /* nl_collect */
+
+/* ------------------------------------------------------------------------- *
+ * nl_merge -- add interval statistics to total.
+ * parameters: total, interval
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void nl_merge(NL_STATS* total, const NL_STATS* stats)
+{
+  lh_merge(&total->hist, &stats->hist);
+  total->tx        += stats->tx;
+  total->rx        += stats->rx;
+  total->failed    += stats->failed;
+  total->zc_done   += stats->zc_done;
+  total->zc_copied += stats->zc_copied;
+} /* nl_merge */
+
+/* ------------------------------------------------------------------------- *
+ * nl_print -- print throughput, rates and round trip latency.
+ * parameters: time label, statistics, period in ns
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void nl_print(const char* when, const NL_STATS* stats, LH_NSEC period)
+{
+  printf ("%s tx %.3f Gbit/s, rx %.3f Gbit/s, %.1f msgs/s, failed %llu",
+          when, stats->tx * 8.0 / period, stats->rx * 8.0 / period,
+          stats->rx * 1e9 / opts.size / period, stats->failed);
+  if (NL_ZeroCopy == opts.method)
+    printf (", zerocopy completed %llu copied %llu", stats->zc_done, stats->zc_copied);
+  printf ("\n");
+
+  if (opts.echo)
+  {
+    char prefix[64];
+
+    snprintf(prefix, sizeof(prefix), "%s rtt", when);
+    lh_print(&stats->hist, prefix);
+  }
+} /* nl_print */
+
+/* ------------------------------------------------------------------------- *
+ * nl_done_handler -- handler for termination signal.
+ * parameters: signal received
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void nl_done_handler(int signo)
+{
+  /* Make compiler happy */
+  signo = signo;
+  done_flag = 1;
+} /* nl_done_handler */
+
+/* ------------------------------------------------------------------------- *
+ * nl_usage -- show usage of application
+ * parameters: application name
+ * returns: 1.
+ * ------------------------------------------------------------------------- */
+
+static int nl_usage(const char* self)
+{
+  printf ("\nUsage: %s [-c <conns>] [-m <bytes>] [-r <rate>] [-e] [-z <method>] [-d <secs>] [-i <secs>] <protocol>\n", self);
+  printf ("\nProtocols:\n");
+  printf ("  tcp\t\tTCP connection over 127.0.0.1.\n");
+  printf ("  udp\t\tconnected UDP sockets on 127.0.0.1, message is one datagram.\n");
+  printf ("  unix\t\tUNIX stream socket pair.\n");
+  printf ("\nOptions:\n");
+  printf ("  -c\t\tnumber of connections, each has sender and receiver thread, default 1.\n");
+  printf ("  -m\t\tmessage size, default %u bytes.\n", NL_SIZE);
+  printf ("  -r\t\tmessages per second per connection, default is unlimited.\n");
+  printf ("  -e\t\treceiver echoes messages back, sender reports round trip time.\n");
+  printf ("  -z\t\tsend method: copy (default), zerocopy (MSG_ZEROCOPY, tcp and udp),\n");
+  printf ("  \t\tsendfile (from memfd) or splice (vmsplice to pipe), tcp and unix.\n");
+  printf ("  -d\t\ttest duration in seconds, default is until terminated.\n");
+  printf ("  -i\t\treport period, default %u seconds.\n", NL_REPORT);
+  printf ("\nExample:\n");
+  printf ("  %s -c 4 -m 65536 tcp\n", self);
+  printf ("  %s -e -m 64 -r 10000 udp\n", self);
+  printf ("\n");
+  return 1;
+} /* nl_usage */
+
+/* ========================================================================= *
+ * Main function.
+ * ========================================================================= */
+
+int main(int argc, char* const argv[])
+{
+  NL_STATS total;
+  NL_STATS interval;
+  LH_NSEC  started;
+  LH_NSEC  last;
+  unsigned index;
+  int      c;
+  int      found;
+
+  printf ("loopback network load generator, build %s %s\n", __DATE__, __TIME__);
+
+  memset(&opts, 0, sizeof(opts));
+  opts.conns  = 1;
+  opts.size   = NL_SIZE;
+  opts.report = NL_REPORT;
+
+  opterr = 0;
+  while ((c = getopt(argc, argv, "c:m:r:ez:d:i:")) != -1)
+  {
+    switch (c)
+    {
+      case 'c':
+        opts.conns = strtoul(optarg, NULL, 0);
+        break;
+      case 'm':
+        opts.size = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        opts.rate = strtoul(optarg, NULL, 0);
+        break;
+      case 'e':
+        opts.echo = 1;
+        break;
+      case 'z':
+        found = nl_lookup(method_names, NL_CAPACITY(method_names), optarg);
+        if (found < 0)
+          return nl_usage(argv[0]);
+        opts.method = (NL_METHOD)found;
+        break;
+      case 'd':
+        opts.t_limit = strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        opts.report = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        return nl_usage(argv[0]);
+    }
+  }
+
+  if (optind != argc - 1 || 0 == opts.conns || 0 == opts.size || 0 == opts.report)
+    return nl_usage(argv[0]);
+
+  found = nl_lookup(proto_names, NL_CAPACITY(proto_names), argv[optind]);
+  if (found <= 0)
+    return nl_usage(argv[0]);
+  opts.proto = (NL_PROTO)found;
+
+  /* combinations the kernel does not support */
+  if ((NL_Udp == opts.proto && (opts.size > NL_UDP_MAX || NL_Sendfile == opts.method || NL_Splice == opts.method)) ||
+      (NL_Unix == opts.proto && NL_ZeroCopy == opts.method))
+  {
+    printf ("%s with %s method and %u bytes messages is not supported\n",
+            proto_names[opts.proto], method_names[opts.method], opts.size);
+    return 1;
+  }
+
+  printf ("%u %s connections, %u bytes messages, %s sending, %s", opts.conns, proto_names[opts.proto],
+          opts.size, method_names[opts.method], (opts.echo ? "echoed" : "streamed"));
+  if (opts.rate)
+    printf (" at %u per second", opts.rate);
+  printf ("\n");
+
+  signal(SIGINT,  nl_done_handler);
+  signal(SIGTERM, nl_done_handler);
+  signal(SIGPIPE, SIG_IGN);
+
+  conns = (NL_CONN*)calloc(opts.conns, sizeof(*conns));
+  if (NULL == conns)
+  {
+    printf ("no memory available\n");
+    return 1;
+  }
+
+  if (nl_setup() < 0)
+    return 1;
+
+  memset(&total, 0, sizeof(total));
+  lh_init(&total.hist);
+  started = last = lh_now();
+  for (index = 0; index < opts.conns; index++)
+  {
+    if (pthread_create(conns[index].threads + 0, NULL, nl_receiver, conns + index) ||
+        pthread_create(conns[index].threads + 1, NULL, nl_sender, conns + index))
+    {
+      printf ("cannot create threads of connection %u\n", index + 1);
+      return 1;
+    }
+  }
+
+  while (!done_flag)
+  {
+    LH_NSEC now;
+    char    when[32];
+
+    sleep(opts.report);
+    if (opts.t_limit && lh_now() - started >= opts.t_limit * 1000000000ULL)
+      done_flag = 1;
+
+    now = lh_now();
+    snprintf(when, sizeof(when), "%7.1f s:", (now - started) / 1e9);
+    nl_collect(&interval);
+    nl_merge(&total, &interval);
+    nl_print(when, &interval, now - last);
+    fflush(stdout);
+    last = now;
+  }
+
+  /* wake up threads blocked in socket calls */
+  for (index = 0; index < opts.conns; index++)
+  {
+    shutdown(conns[index].client, SHUT_RDWR);
+    shutdown(conns[index].server, SHUT_RDWR);
+  }
+
+  for (index = 0; index < opts.conns; index++)
+  {
+    pthread_join(conns[index].threads[0], NULL);
+    pthread_join(conns[index].threads[1], NULL);
+  }
+
+  nl_collect(&interval);
+  nl_merge(&total, &interval);
+
+  last = lh_now();
+  printf ("total: %.1f s\n", (last - started) / 1e9);
+  nl_print("total:", &total, last - started);
+
+  return 0;
+} /* main */
+
+/* ========================================================================= *
+ *                    No more code in file netload.c                         *
+ * ========================================================================= */
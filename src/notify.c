@@ -0,0 +1,202 @@
+/* ========================================================================= *
+ * File: notify.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Readiness notification, see notify.h for details.
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "notify.h"
+
+/* ========================================================================= *
+ * Local data.
+ * ========================================================================= */
+
+static int             nt_fd = -1;      /* inherited descriptor or -1   */
+static const char*     nt_pidfile;      /* pidfile path or NULL         */
+static struct timespec nt_started;      /* moment of nt_setup call      */
+static struct timespec nt_filling;      /* moment of nt_fill_start call */
+static int             nt_running;      /* fill clock is running        */
+static double          nt_filled;       /* fill time before nt_filling  */
+static unsigned        nt_fill_size;    /* MB at nt_fill_stop or 0      */
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * nt_since -- seconds since the given moment.
+ * parameters: moment
+ * returns: seconds.
+ * ------------------------------------------------------------------------- */
+
+static double nt_since(const struct timespec* moment)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - moment->tv_sec) + (now.tv_nsec - moment->tv_nsec) / 1e9;
+} /* nt_since */
+
+/* ------------------------------------------------------------------------- *
+ * nt_write_pidfile -- create pidfile atomically.
+ * parameters: nothing
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void nt_write_pidfile(void)
+{
+  char  temp[4096];
+  FILE* fp;
+
+  snprintf(temp, sizeof(temp), "%s.tmp", nt_pidfile);
+  fp = fopen(temp, "w");
+  if (NULL == fp)
+  {
+    printf ("cannot create pidfile %s: %s\n", temp, strerror(errno));
+    return;
+  }
+
+  fprintf(fp, "%u\n", (unsigned)getpid());
+  if (0 != fclose(fp) || rename(temp, nt_pidfile) < 0)
+    printf ("cannot create pidfile %s: %s\n", nt_pidfile, strerror(errno));
+} /* nt_write_pidfile */
+
+/* ------------------------------------------------------------------------- *
+ * nt_sd_notify -- send state to service manager if NOTIFY_SOCKET is set.
+ * parameters: state string
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void nt_sd_notify(const char* state)
+{
+  const char* path = getenv("NOTIFY_SOCKET");
+  struct sockaddr_un addr;
+  socklen_t len;
+  int fd;
+
+  if (NULL == path || ('/' != path[0] && '@' != path[0]) || strlen(path) >= sizeof(addr.sun_path))
+    return;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  len = offsetof(struct sockaddr_un, sun_path) + strlen(path);
+
+  /* abstract namespace socket */
+  if ('@' == path[0])
+    addr.sun_path[0] = 0;
+  else
+    len++;
+
+  fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return;
+  if (sendto(fd, state, strlen(state), MSG_NOSIGNAL, (struct sockaddr*)&addr, len) < 0)
+    printf ("cannot notify %s: %s\n", path, strerror(errno));
+  close(fd);
+} /* nt_sd_notify */
+
+/* ========================================================================= *
+ * Public methods.
+ * ========================================================================= */
+
+void nt_setup(int fd, const char* pidfile)
+{
+  clock_gettime(CLOCK_MONOTONIC, &nt_started);
+  nt_filling = nt_started;
+  nt_running = 1;
+  nt_fd      = fd;
+  nt_pidfile = pidfile;
+} /* nt_setup */
+
+void nt_fill_start(void)
+{
+  /* time before setup or the first start is not fill */
+  if (nt_running)
+    nt_filled = 0;
+  clock_gettime(CLOCK_MONOTONIC, &nt_filling);
+  nt_running = 1;
+} /* nt_fill_start */
+
+void nt_fill_stop(unsigned size)
+{
+  if (nt_running)
+    nt_filled += nt_since(&nt_filling);
+  nt_running   = 0;
+  nt_fill_size = size;
+} /* nt_fill_stop */
+
+void nt_ready(unsigned size)
+{
+  const double   ready  = nt_since(&nt_started);
+  const double   fill   = nt_filled + (nt_running ? nt_since(&nt_filling) : 0.0);
+  const unsigned filled = (nt_fill_size ? nt_fill_size : size);
+  const double   rate   = (fill > 0 ? filled / fill : 0.0);
+  char message[256];
+
+  if (filled != size)
+    printf ("ready in %.3f s, %u MB kept of %u MB filled at %.1f MB/s\n", ready, size, filled, rate);
+  else
+    printf ("ready in %.3f s, %u MB filled at %.1f MB/s\n", ready, size, rate);
+  fflush(stdout);
+
+  if (nt_pidfile)
+    nt_write_pidfile();
+
+  snprintf(message, sizeof(message), "READY=1\nSTATUS=ready in %.3f s, %u MB filled at %.1f MB/s\nMAINPID=%u",
+           ready, size, rate, (unsigned)getpid());
+  nt_sd_notify(message);
+
+  /* descriptor is the last one, so all others are done when it is closed */
+  if (nt_fd >= 0)
+  {
+    const int len = snprintf(message, sizeof(message), "READY=1 TIME=%.3f SIZE=%u RATE=%.1f\n", ready, size, rate);
+    if (write(nt_fd, message, len) != len)
+      printf ("cannot notify descriptor %d: %s\n", nt_fd, strerror(errno));
+    close(nt_fd);
+    nt_fd = -1;
+  }
+} /* nt_ready */
+
+void nt_forget(void)
+{
+  if (nt_fd >= 0)
+    close(nt_fd);
+  nt_fd = -1;
+  nt_pidfile = NULL;
+  unsetenv("NOTIFY_SOCKET");
+} /* nt_forget */
+
+/* ========================================================================= *
+ *                    No more code in file notify.c                          *
+ * ========================================================================= */
@@ -0,0 +1,51 @@
+/* ========================================================================= *
+ * File: notify.h
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Readiness notification for harnesses which start a load tool and
+ *    need to know when the load is actually in place. When the tool is
+ *    ready, nt_ready reports time since nt_setup and the fill rate:
+ *    - to an inherited file descriptor as one line
+ *        READY=1 TIME=<seconds> SIZE=<MB> RATE=<MB/s>
+ *      after which the descriptor is closed, so waiting for EOF works too
+ *    - by creating a pidfile
+ *    - by sending READY=1 datagram to $NOTIFY_SOCKET, like sd_notify(3)
+ * ========================================================================= */
+
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+/* Remembers start time and notification targets, fd < 0 and NULL pidfile disable them */
+void nt_setup(int fd, const char* pidfile);
+
+/* Marks start of the fill which rate is reported, or resumes its clock
+   after nt_fill_stop, e.g. when the fill was paused */
+void nt_fill_start(void);
+
+/* Stops the fill clock with size filled so far in MB */
+void nt_fill_stop(unsigned size);
+
+/* Sends notifications, size is amount of memory in place in MB; the rate
+   is of the size given to nt_fill_stop if it was called */
+void nt_ready(unsigned size);
+
+/* Closes inherited descriptor in forked children without notifying */
+void nt_forget(void);
+
+#endif /* NOTIFY_H */
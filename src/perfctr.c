@@ -0,0 +1,264 @@
+/* ========================================================================= *
+ * File: perfctr.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Self-monitoring performance counters, see perfctr.h for details.
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perfctr.h"
+
+/* ========================================================================= *
+ * Definitions.
+ * ========================================================================= */
+
+#define PC_PARANOID  "/proc/sys/kernel/perf_event_paranoid"
+
+#define PC_CACHE(cache)  ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+typedef struct
+{
+  unsigned    type;   /* PERF_TYPE_XXX                 */
+  unsigned    config; /* event id inside of the type   */
+  const char* name;   /* name used in output           */
+} PC_DESC;
+
+static const PC_DESC pc_desc[PC_COUNT] =
+{
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,        "cycles"    },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,      "instr"     },
+  { PERF_TYPE_HW_CACHE, PC_CACHE(PERF_COUNT_HW_CACHE_LL),   "llc-miss"  },
+  { PERF_TYPE_HW_CACHE, PC_CACHE(PERF_COUNT_HW_CACHE_DTLB), "dtlb-miss" },
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS,       "faults"    }
+};
+
+/* ========================================================================= *
+ * Local methods.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * pc_open_one -- open one counter for the calling thread.
+ * parameters: event description, exclude kernel flag
+ * returns: file descriptor or -1 with errno set.
+ * ------------------------------------------------------------------------- */
+
+static int pc_open_one(const PC_DESC* desc, int user_only)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.type           = desc->type;
+  attr.config         = desc->config;
+  attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_hv     = 1;
+  attr.exclude_kernel = (user_only ? 1 : 0);
+
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+} /* pc_open_one */
+
+/* ------------------------------------------------------------------------- *
+ * pc_paranoid -- read current perf_event_paranoid level.
+ * parameters: nothing
+ * returns: level or -99 if it could not be read.
+ * ------------------------------------------------------------------------- */
+
+static int pc_paranoid(void)
+{
+  int   level = -99;
+  FILE* fp = fopen(PC_PARANOID, "r");
+
+  if (fp)
+  {
+    if (1 != fscanf(fp, "%d", &level))
+      level = -99;
+    fclose(fp);
+  }
+
+  return level;
+} /* pc_paranoid */
+
+/* ------------------------------------------------------------------------- *
+ * pc_read -- read scaled counter value.
+ * parameters: file descriptor, value to fill, multiplexing taken into account
+ * returns: 0 if read, -1 if failed or counter has not run yet.
+ * ------------------------------------------------------------------------- */
+
+static int pc_read(int fd, unsigned long long* value)
+{
+  unsigned long long data[3];  /* value, time enabled, time running */
+
+  if (sizeof(data) != read(fd, data, sizeof(data)) || 0 == data[2])
+    return -1;
+
+  if (data[1] == data[2])
+    *value = data[0];
+  else
+    *value = (unsigned long long)((double)data[0] * data[1] / data[2]);
+
+  return 0;
+} /* pc_read */
+
+/* ------------------------------------------------------------------------- *
+ * pc_open_set -- open all counters with the same scope.
+ * parameters: set to fill, exclude kernel flag, counter of denied ones
+ * returns: number of opened counters.
+ * ------------------------------------------------------------------------- */
+
+static int pc_open_set(PC_SET* set, int user_only, int* denied)
+{
+  unsigned index;
+  int      opened = 0;
+
+  for (index = 0; index < PC_COUNT; index++)
+  {
+    set->fd[index] = pc_open_one(pc_desc + index, user_only);
+    if (set->fd[index] < 0)
+    {
+      if (EACCES == errno || EPERM == errno)
+        (*denied)++;
+      else if (ENOSYS == errno)
+        break;
+    }
+    else
+      opened++;
+  }
+
+  /* remaining ones are not opened due to break */
+  while (index < PC_COUNT)
+    set->fd[index++] = -1;
+
+  return opened;
+} /* pc_open_set */
+
+/* ========================================================================= *
+ * Public methods.
+ * ========================================================================= */
+
+int pc_open(PC_SET* set)
+{
+  int user_only = 0;
+  int denied = 0;
+  int opened;
+
+  memset(set, 0, sizeof(*set));
+  opened = pc_open_set(set, user_only, &denied);
+
+  /* paranoid level 2 allows only user-space counting, then all counters
+     are reopened so, otherwise their values could not be compared */
+  if (denied)
+  {
+    pc_close(set);
+    user_only = 1;
+    denied    = 0;
+    opened    = pc_open_set(set, user_only, &denied);
+  }
+
+  if (0 == opened)
+  {
+    if (denied)
+      printf ("performance counters are not permitted (%s is %d), continuing without them\n",
+              PC_PARANOID, pc_paranoid());
+    else
+      printf ("performance counters are not available, continuing without them\n");
+    return 0;
+  }
+
+  if (user_only)
+    printf ("performance counters are counting only user space (%s is %d)\n",
+            PC_PARANOID, pc_paranoid());
+  else
+    printf ("performance counters are counting user and kernel space\n");
+
+  pc_sample(set);
+  return opened;
+} /* pc_open */
+
+void pc_sample(PC_SET* set)
+{
+  unsigned index;
+
+  for (index = 0; index < PC_COUNT; index++)
+  {
+    unsigned long long value;
+
+    /* failed read keeps the previous value, so the next delta does not wrap */
+    set->valid[index] = (set->fd[index] >= 0 && 0 == pc_read(set->fd[index], &value));
+    if (set->valid[index])
+    {
+      set->delta[index] = value - set->last[index];
+      set->last[index]  = value;
+    }
+    else
+      set->delta[index] = 0;
+  }
+} /* pc_sample */
+
+void pc_print(const PC_SET* set, const char* prefix)
+{
+  unsigned index;
+  int      available = 0;
+
+  for (index = 0; index < PC_COUNT; index++)
+    available |= (set->fd[index] >= 0);
+  if (!available)
+    return;
+
+  printf ("%s", prefix);
+  for (index = 0; index < PC_COUNT; index++)
+  {
+    if (set->valid[index])
+      printf (" %s %llu", pc_desc[index].name, set->delta[index]);
+    else
+      printf (" %s n/a", pc_desc[index].name);
+  }
+
+  if (set->valid[PC_CYCLES] && set->valid[PC_INSTRUCTIONS] && set->delta[PC_CYCLES])
+    printf (" ipc %.2f", (double)set->delta[PC_INSTRUCTIONS] / set->delta[PC_CYCLES]);
+  printf ("\n");
+} /* pc_print */
+
+void pc_close(PC_SET* set)
+{
+  unsigned index;
+
+  for (index = 0; index < PC_COUNT; index++)
+  {
+    if (set->fd[index] >= 0)
+      close(set->fd[index]);
+    set->fd[index] = -1;
+  }
+} /* pc_close */
+
+/* ========================================================================= *
+ *                    No more code in file perfctr.c                         *
+ * ========================================================================= */
@@ -0,0 +1,60 @@
+/* ========================================================================= *
+ * File: perfctr.h
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Self-monitoring hardware/software performance counters opened with
+ *    perf_event_open(2) for the calling thread. Counters which are not
+ *    supported or not permitted (see /proc/sys/kernel/perf_event_paranoid)
+ *    are silently reported as "n/a", so load tools keep working without.
+ * ========================================================================= */
+
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+typedef enum
+{
+  PC_CYCLES,          /* CPU cycles                          */
+  PC_INSTRUCTIONS,    /* retired instructions                */
+  PC_LLC_MISSES,      /* last level cache read misses        */
+  PC_DTLB_MISSES,     /* data TLB read misses                */
+  PC_PAGE_FAULTS,     /* page faults, software event         */
+  PC_COUNT
+} PC_EVENT;
+
+typedef struct
+{
+  int                fd[PC_COUNT];      /* -1 if counter is not available  */
+  unsigned long long last[PC_COUNT];    /* scaled value at previous sample */
+  unsigned long long delta[PC_COUNT];   /* difference since previous sample */
+  int                valid[PC_COUNT];   /* delta was read in this interval  */
+} PC_SET;
+
+/* Opens counters for the calling thread, returns number of opened ones */
+int  pc_open(PC_SET* set);
+
+/* Reads counters and updates deltas since the previous pc_sample call */
+void pc_sample(PC_SET* set);
+
+/* Prints the latest deltas as one line with the given prefix */
+void pc_print(const PC_SET* set, const char* prefix);
+
+/* Closes all counters */
+void pc_close(PC_SET* set);
+
+#endif /* PERFCTR_H */
@@ -0,0 +1,114 @@
+/* ========================================================================= *
+ * File: schedopt.c
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Scheduling policy options, see schedopt.h for details.
+ * ========================================================================= */
+
+/* ========================================================================= *
+ * Includes
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "schedopt.h"
+
+/* ========================================================================= *
+ * Public methods.
+ * ========================================================================= */
+
+int so_parse(const char* arg, char* id, int* prio)
+{
+  if (!arg[0] || !strchr("lhbfroLHBFRO", arg[0])
+      || (arg[1] && (arg[1] != ':' || !isdigit((unsigned char)arg[2]))))
+    return -1;
+
+  *id   = tolower(arg[0]);
+  *prio = (arg[1] ? atoi(arg + 2) : -1);
+  return 0;
+} /* so_parse */
+
+int so_realtime(char id)
+{
+  return ('f' == tolower(id) || 'r' == tolower(id));
+} /* so_realtime */
+
+int so_apply(char id, int prio, const char* what)
+{
+  struct sched_param param;
+  int policy;
+
+  switch (tolower(id))
+  {
+    case 'l':
+    case 'h':
+    {
+      /* like nice(+-19) relative to the current value, but nice value is
+         per thread in Linux; gettid() wrapper needs glibc 2.30 */
+      const id_t tid = (id_t)syscall(SYS_gettid);
+      int nice_value;
+
+      errno = 0;
+      nice_value = getpriority(PRIO_PROCESS, tid);
+      if (0 == errno)
+      {
+        nice_value += ('l' == tolower(id) ? 19 : -19);
+        nice_value = (nice_value < -20 ? -20 : (nice_value > 19 ? 19 : nice_value));
+      }
+      if (errno || setpriority(PRIO_PROCESS, tid, nice_value) < 0)
+        fprintf(stderr, "\nWARNING: setting %s priority failed: operating with default.\nReason: %s\n", what, strerror(errno));
+      return 0;
+    }
+    case 'b':
+      policy = SCHED_BATCH;
+      break;
+    case 'f':
+      policy = SCHED_FIFO;
+      break;
+    case 'r':
+      policy = SCHED_RR;
+      break;
+    case 'o':
+      policy = SCHED_OTHER;
+      break;
+    default:
+      return -1;
+  }
+
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = (prio < 0 || !so_realtime(id) ? sched_get_priority_max(policy) : prio);
+  if (sched_setscheduler((pid_t)syscall(SYS_gettid), policy, &param) < 0)
+    fprintf(stderr, "\nWARNING: setting %s scheduler failed: operating with default.\nReason: %s\n", what, strerror(errno));
+
+  return 0;
+} /* so_apply */
+
+/* ========================================================================= *
+ *                    No more code in file schedopt.c                        *
+ * ========================================================================= */
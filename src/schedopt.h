@@ -0,0 +1,59 @@
+/* ========================================================================= *
+ * File: schedopt.h
+ *
+ * This file is part of sp-stress.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Description:
+ *    Scheduling policy options shared by load tools. A policy is given as
+ *    one letter id, optionally followed by real-time priority, e.g. "f:50":
+ *      l - lowest nice() priority
+ *      h - highest nice() priority
+ *      b - SCHED_BATCH
+ *      f - SCHED_FIFO (real time)
+ *      r - SCHED_RR (real time)
+ *      o - SCHED_OTHER (default)
+ *    Policy and nice value are applied to the calling thread only, threads
+ *    and processes created after that inherit them.
+ * ========================================================================= */
+
+#ifndef SCHEDOPT_H
+#define SCHEDOPT_H
+
+/* Policy list for usage texts */
+#define SO_USAGE \
+  "\tl -- lowest nice() priority\n" \
+  "\th -- highest nice() priority\n" \
+  "\tb -- use SCHED_BATCH scheduler\n" \
+  "\tf -- use SCHED_FIFO scheduler (real time)\n" \
+  "\tr -- use SCHED_RR scheduler (real time)\n" \
+  "\to -- use SCHED_OTHER (default) scheduler\n"
+
+/* Parses "<id>[:<prio>]", id is lower-cased, prio is -1 if not given.
+ * Returns 0 if succeeded.
+ */
+int so_parse(const char* arg, char* id, int* prio);
+
+/* Returns non-zero for real-time policy ids */
+int so_realtime(char id);
+
+/* Applies policy id with prio (-1 for the highest) to the calling thread,
+ * what names it in the warning printed on failure. Returns -1 for unknown
+ * id, failures to apply only produce the warning.
+ */
+int so_apply(char id, int prio, const char* what);
+
+#endif /* SCHEDOPT_H */
@@ -59,8 +59,15 @@
  * Includes
  * ========================================================================= */
 
+#define _GNU_SOURCE
+
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -68,6 +75,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "lathist.h"
+#include "notify.h"
+#include "perfctr.h"
+
 /* ========================================================================= *
  * General settings.
  * ========================================================================= */
@@ -76,6 +87,8 @@
 #define SL_SIGTIME        SIGALRM   /* Testing done, no more execution is expected  */
 #define SL_SIGDONE        SIGTERM   /* Testing done, no more execution is expected  */
 #define SL_SIGINFO        SIGUSR1   /* Which signal used in for information excange */
+#define SL_DIR            "/var/tmp" /* Default directory for file backed worksets  */
+#define SL_FILL_BLOCK     (1 << 20) /* Block size to write file for private mapping */
 
 #define SL_CAPACITY(a)    (sizeof(a) / sizeof(*a))
 
@@ -91,6 +104,17 @@ typedef enum
   SL_PseudoRandom     /* Working mode is pseudo-random, see the SL_PSEUDO_RANDOM */
 } SL_MODE;
 
+typedef enum
+{
+  SL_Anon,            /* Private anonymous memory, served from swap       */
+  SL_File,            /* MAP_SHARED file, written back to the filesystem  */
+  SL_Private,         /* MAP_PRIVATE file, clean pages re-read from file  */
+  SL_Memfd,           /* memfd (shmem), served from swap                  */
+  SL_Sysv,            /* SysV shm segment shared by all clients           */
+  SL_Cow,             /* Anonymous memory of controller, COW after fork   */
+  SL_BackingUnknown
+} SL_BACKING;
+
 
 typedef struct
 {
@@ -99,6 +123,11 @@ typedef struct
   time_t    t_limit;  /* Time when we shall stop or 0 if unlimited mode */
   SL_MODE   cl_mode;  /* Mode to choose the next client to be iterated  */
   SL_MODE   pg_mode;  /* Mode to choose the next page to be accessed    */
+  int       counters; /* Report performance counters for every pass     */
+  SL_BACKING backing; /* Memory which backs the workset of clients      */
+  const char* dir;    /* Directory for files of file backed worksets    */
+  int*      shared;   /* SysV segment or COW region made before fork    */
+  time_t    refork;   /* Period to re-create all clients or 0           */
   pid_t*    pids;     /* Process IDs for all clients                    */
 }  SL_OPTS;
 
@@ -110,6 +139,8 @@ static SL_OPTS  opts;       /* Program options which are shared between this ses
 static volatile int info_flag; /* Flag to indicate that signal is received for sl_wait  */
 static unsigned pagesize = 0;  /* Shall be set later */
 
+static const char* const backings[] = { "anon", "file", "private", "memfd", "sysv", "cow" };
+
 /* This data is used in sl_this call */
 static pid_t        this_pid  = 0;
 static const char*  this_name = "main";
@@ -191,6 +222,20 @@ static void sl_wait_info(void)
     usleep(0);
 } /* sl_wait_info */
 
+/* ------------------------------------------------------------------------- *
+ * sl_now -- monotonic time for pass measurement.
+ * parameters: nothing
+ * returns: seconds.
+ * ------------------------------------------------------------------------- */
+
+static double sl_now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+} /* sl_now */
+
 /* ------------------------------------------------------------------------- *
  * sl_send_info -- send informational signal to pointed pid.
  * parameters: pid or 0 (for parent)
@@ -251,6 +296,10 @@ static void sl_done_handler(int signo)
  * ========================================================================= */
 
 static int* workset = NULL;   /* Data to be accessed at the client side */
+static PC_SET counters;       /* Performance counters of the client      */
+static unsigned char* resident = NULL; /* Pages resident at pass start    */
+static unsigned char* dirtied  = NULL; /* Pages modified by this client   */
+static unsigned       forked   = 0;    /* Private kB after initialization */
 
 
 /* ------------------------------------------------------------------------- *
@@ -266,6 +315,166 @@ static void slc_die(void)
   kill(father, SL_SIGDONE);
 } /* slc_die */
 
+/* ------------------------------------------------------------------------- *
+ * slc_file -- create unlinked file of required size in the directory.
+ * parameters: size in bytes, contents to be written or 0 for sparse file.
+ * returns: file descriptor or -1 if failed.
+ * ------------------------------------------------------------------------- */
+
+static int slc_file(size_t size, int fill)
+{
+  char   path[1024];
+  char*  block;
+  size_t done;
+  int    fd;
+
+  snprintf(path, sizeof(path), "%s/swpload.XXXXXX", opts.dir);
+  fd = mkstemp(path);
+  if (fd < 0)
+  {
+    printf ("%s cannot create file in %s: %s\n", sl_this(), opts.dir, strerror(errno));
+    return -1;
+  }
+  unlink(path);
+
+  if (ftruncate(fd, size) < 0)
+  {
+    printf ("%s cannot resize file to %u MB: %s\n", sl_this(), (unsigned)(size >> 20), strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  if (!fill)
+    return fd;
+
+  /* too big for stack of a client */
+  block = (char*)malloc(SL_FILL_BLOCK);
+  if (NULL == block)
+  {
+    printf ("%s no memory for file block\n", sl_this());
+    close(fd);
+    return -1;
+  }
+
+  /* private mapping shall find the data in the file, not in the mapping */
+  memset(block, fill, SL_FILL_BLOCK);
+  for (done = 0; done < size; done += SL_FILL_BLOCK)
+  {
+    const size_t len = (size - done < SL_FILL_BLOCK ? size - done : SL_FILL_BLOCK);
+    if (pwrite(fd, block, len, done) != (ssize_t)len)
+    {
+      printf ("%s cannot write file: %s\n", sl_this(), strerror(errno));
+      free(block);
+      close(fd);
+      return -1;
+    }
+  }
+
+  free(block);
+  return fd;
+} /* slc_file */
+
+/* ------------------------------------------------------------------------- *
+ * slc_map -- create workset memory according to selected backing.
+ * parameters: size in bytes.
+ * returns: filled workset or NULL if failed.
+ * ------------------------------------------------------------------------- */
+
+static int* slc_map(size_t size)
+{
+  void* data  = MAP_FAILED;
+  int   flags = MAP_SHARED;
+  int   fd    = -1;
+
+  switch (opts.backing)
+  {
+    case SL_Sysv:
+    case SL_Cow:
+      /* attachment or mapping inherited from controller, already filled */
+      return opts.shared;
+
+    case SL_Anon:
+      data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      break;
+
+    case SL_Memfd:
+      fd = memfd_create("swpload", MFD_CLOEXEC);
+      if (fd < 0 || ftruncate(fd, size) < 0)
+      {
+        printf ("%s cannot create memfd: %s\n", sl_this(), strerror(errno));
+        if (fd >= 0)
+          close(fd);
+        fd = -1;
+      }
+      break;
+
+    case SL_File:
+      fd = slc_file(size, 0);
+      break;
+
+    case SL_Private:
+      fd = slc_file(size, 0x55);
+      flags = MAP_PRIVATE;
+      break;
+
+    default:
+      break;
+  }
+
+  if (fd >= 0)
+  {
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    close(fd);
+  }
+
+  if (MAP_FAILED == data)
+    return NULL;
+
+  if (SL_Private == opts.backing)
+  {
+    /* read every page to map clean copies of file pages */
+    volatile const int* page = (const int*)data;
+    size_t offset;
+    int    sum = 0;
+
+    for (offset = 0; offset < size; offset += pagesize)
+      sum += page[offset / sizeof(*page)];
+    (void)sum;
+  }
+  else
+  {
+    memset(data, 0x55, size);
+  }
+
+  return (int*)data;
+} /* slc_map */
+
+/* ------------------------------------------------------------------------- *
+ * slc_private -- private memory of the client, i.e. pages it has copied.
+ * parameters: nothing
+ * returns: Private_Clean + Private_Dirty in kB or 0 if not available.
+ * ------------------------------------------------------------------------- */
+
+static unsigned slc_private(void)
+{
+  FILE*    fp = fopen("/proc/self/smaps_rollup", "r");
+  char     line[128];
+  unsigned total = 0;
+  unsigned kb;
+
+  if ( !fp )
+    return 0;
+
+  while ( fgets(line, sizeof(line), fp) )
+  {
+    if (1 == sscanf(line, "Private_Clean: %u kB", &kb) || 1 == sscanf(line, "Private_Dirty: %u kB", &kb))
+      total += kb;
+  }
+
+  fclose(fp);
+  return total;
+} /* slc_private */
+
 /* ------------------------------------------------------------------------- *
  * slc_init -- initialize required space of data.
  * parameters: nothing
@@ -280,22 +489,52 @@ static void slc_init(void)
 
   free(opts.pids);
   opts.pids = NULL;
+  nt_forget();
 
   /* Initialize workset */
-  workset = (int*) malloc(opts.workset * pagesize);
-  if (NULL == workset)
+  workset  = slc_map((size_t)opts.workset * pagesize);
+  resident = (unsigned char*) malloc(opts.workset);
+  dirtied  = (unsigned char*) calloc(opts.workset, 1);
+  if (NULL == workset || NULL == resident || NULL == dirtied)
   {
     printf ("[%s no space available to create test set\n", sl_this());
     slc_die();
   }
   else
   {
-    memset(workset, 0x55, opts.workset * pagesize);
+    if (opts.counters)
+      opts.counters = pc_open(&counters);
+    forked = slc_private();
     printf ("%s initialization completed\n", sl_this());
+    /* start signal may come right after this one */
+    info_flag = 0;
     sl_send_info(0);
   }
 } /* slc_init */
 
+/* ------------------------------------------------------------------------- *
+ * slc_swapped -- guess where page absent at pass start is brought from,
+ *    it is not measured but follows from the backing and dirtied pages.
+ * parameters: page index
+ * returns: 1 if page is served from swap, 0 if from the filesystem.
+ * ------------------------------------------------------------------------- */
+
+static int slc_swapped(unsigned page_id)
+{
+  switch (opts.backing)
+  {
+    case SL_File:
+      return 0;
+
+    case SL_Private:
+      /* once modified the page is anonymous copy of the file page */
+      return dirtied[page_id];
+
+    default:
+      return 1;
+  }
+} /* slc_swapped */
+
 /* ------------------------------------------------------------------------- *
  * slc_main -- main testing function.
  * parameters: nothing
@@ -306,29 +545,86 @@ static void slc_main(void)
 {
   const unsigned i2p_shift = 10;  /* shift left which equal to pagesize / sizeof(*workset) */
 
-  info_flag = 0;
   while (1)
   {
     unsigned iterations;
     unsigned page_id = 0;
     int*     page_ptr;
+    unsigned from_swap = 0;
+    unsigned from_file = 0;
+    struct rusage usage[2];
+    double   started;
+    double   elapsed;
+    LH_HIST  cow;
 
     printf ("%s waiting for test run start\n", sl_this());
     sl_wait_info();
     info_flag = 0;
     printf ("%s test run started\n", sl_this());
 
+    /* pages which are not resident now will cause major faults */
+    if (mincore(workset, (size_t)opts.workset * pagesize, resident) < 0)
+      memset(resident, 1, opts.workset);
+    getrusage(RUSAGE_SELF, usage);
+    lh_init(&cow);
+    started = sl_now();
+    if (opts.counters)
+      pc_sample(&counters);
+
     for (iterations = 0; iterations < opts.workset; iterations++)
     {
+      /* first access to absent page in this pass */
+      if ( !(resident[page_id] & 1) )
+      {
+        resident[page_id] = 1;
+        if ( slc_swapped(page_id) )
+          from_swap++;
+        else
+          from_file++;
+      }
+
       /* access to page with number pageid */
       page_ptr = workset + (page_id << i2p_shift);
-      *page_ptr ^= *page_ptr;
+      if (SL_Cow == opts.backing && !dirtied[page_id])
+      {
+        /* the first write breaks sharing with controller */
+        const LH_NSEC before = lh_now();
+        *page_ptr ^= *page_ptr;
+        lh_add(&cow, lh_now() - before);
+      }
+      else
+      {
+        *page_ptr ^= *page_ptr;
+      }
+      dirtied[page_id] = 1;
 
       /* calculate the next page */
       page_id = sl_succ(opts.pg_mode, page_id, opts.workset);
     }
 
     printf ("%s test run finished\n", sl_this());
+    if (opts.counters)
+    {
+      pc_sample(&counters);
+      pc_print(&counters, sl_this());
+    }
+    getrusage(RUSAGE_SELF, usage + 1);
+    elapsed = sl_now() - started;
+    printf ("%s pass %.6f s, faults major %ld minor %ld, absent pages %u, estimated from swap %u from filesystem %u\n",
+            sl_this(), elapsed,
+            usage[1].ru_majflt - usage[0].ru_majflt, usage[1].ru_minflt - usage[0].ru_minflt,
+            from_swap + from_file, from_swap, from_file);
+    if (SL_Cow == opts.backing)
+    {
+      const unsigned now = slc_private();
+      char prefix[96];
+
+      printf ("%s cow faults %llu at %.0f/s, private %u MB, grown %u MB since fork\n",
+              sl_this(), cow.count, (elapsed > 0 ? cow.count / elapsed : 0.0),
+              now >> 10, (now > forked ? now - forked : 0) >> 10);
+      snprintf(prefix, sizeof(prefix), "%s cow fault latency", sl_this());
+      lh_print(&cow, prefix);
+    }
     sl_send_info(0);
   } /* while testing loop */
 } /* slc_main */
@@ -383,9 +679,136 @@ static void slm_dump_params(void)
   printf ("%s test duration limit %u seconds\n", th, (unsigned)opts.t_limit);
   printf ("%s client selection mode is %s\n", th, slm_getmodestr(opts.cl_mode));
   printf ("%s pages selection mode is %s\n", th, slm_getmodestr(opts.pg_mode));
+  printf ("%s workset backing is %s", th, backings[opts.backing]);
+  if (SL_File == opts.backing || SL_Private == opts.backing)
+    printf (" in %s", opts.dir);
+  printf ("\n");
 } /* slm_dump_params */
 
 
+/* ------------------------------------------------------------------------- *
+ * slm_getbacking -- parse workset backing name.
+ * parameters: name.
+ * returns: backing or SL_BackingUnknown.
+ * ------------------------------------------------------------------------- */
+
+static SL_BACKING slm_getbacking(const char* name)
+{
+  unsigned index;
+
+  for (index = 0; index < SL_CAPACITY(backings); index++)
+    if ( !strcmp(name, backings[index]) )
+      return (SL_BACKING)index;
+
+  return SL_BackingUnknown;
+} /* slm_getbacking */
+
+/* ------------------------------------------------------------------------- *
+ * slm_share -- create SysV segment or COW region for all clients.
+ * parameters: size in bytes.
+ * returns: 0 if succeeded.
+ * ------------------------------------------------------------------------- */
+
+static int slm_share(size_t size)
+{
+  int   id;
+  void* data;
+
+  if (SL_Cow == opts.backing)
+  {
+    /* clients inherit it and copy every page they write */
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == data)
+    {
+      printf ("%s cannot map %u MB: %s\n", sl_this(), (unsigned)(size >> 20), strerror(errno));
+      return -1;
+    }
+    memset(data, 0x55, size);
+    opts.shared = (int*)data;
+    return 0;
+  }
+
+  id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (id < 0)
+  {
+    printf ("%s cannot create shm segment of %u MB: %s\n", sl_this(), (unsigned)(size >> 20), strerror(errno));
+    return -1;
+  }
+
+  /* segment is removed when the last client detaches */
+  data = shmat(id, NULL, 0);
+  shmctl(id, IPC_RMID, NULL);
+  if ((void*)-1 == data)
+  {
+    printf ("%s cannot attach shm segment: %s\n", sl_this(), strerror(errno));
+    return -1;
+  }
+
+  memset(data, 0x55, size);
+  opts.shared = (int*)data;
+  return 0;
+} /* slm_share */
+
+/* ------------------------------------------------------------------------- *
+ * slm_spawn -- create test client and wait for its initialization.
+ * parameters: client index.
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void slm_spawn(unsigned index)
+{
+  double  started;
+  pid_t   postfork;
+
+  printf ("%s creating test client %u\n", sl_this(), index + 1);
+
+  /* One more fork() usage example */
+  info_flag = 0;
+  started  = sl_now();
+  postfork = fork();
+  switch (postfork)
+  {
+    case 0:   /* I am a child */
+        slc_init();
+        slc_main();
+        raise(SL_SIGDONE);
+      break;
+
+    case -1:  /* Bug happened */
+        printf ("%s error %d - %s\n", sl_this(), errno, strerror(errno));
+        raise(SL_SIGDONE);
+      break;
+
+    default:  /* I am a parent */
+        opts.pids[index] = postfork;
+        printf ("%s waiting for test client %u pid %u initialization, forked in %.3f ms\n",
+                sl_this(), index + 1, postfork, (sl_now() - started) * 1e3);
+        sl_wait_info();
+      break;
+  }
+} /* slm_spawn */
+
+/* ------------------------------------------------------------------------- *
+ * slm_refork -- replace all clients by new ones, like repeated snapshots.
+ * parameters: nothing.
+ * returns: nothing.
+ * ------------------------------------------------------------------------- */
+
+static void slm_refork(void)
+{
+  unsigned index;
+
+  printf ("%s re-forking %u clients\n", sl_this(), opts.clients);
+  for (index = 0; index < opts.clients; index++)
+  {
+    kill(opts.pids[index], SL_SIGDONE);
+    waitpid(opts.pids[index], NULL, 0);
+  }
+
+  for (index = 0; index < opts.clients; index++)
+    slm_spawn(index);
+} /* slm_refork */
+
 /* ------------------------------------------------------------------------- *
  * slm_main -- main part of test controller: select test, kick, wait for done.
  * parameters: nothing.
@@ -394,7 +817,8 @@ static void slm_dump_params(void)
 
 static void slm_main(void)
 {
-  unsigned current = 0;
+  unsigned current   = 0;
+  time_t   fork_time = time(NULL);
 
   printf ("%s test cycle is started for %u seconds\n", sl_this(), (unsigned)opts.t_limit);
   alarm(opts.t_limit);
@@ -405,6 +829,12 @@ static void slm_main(void)
     sl_send_info(opts.pids[current]);
     sl_wait_info();
 
+    if (opts.refork && time(NULL) - fork_time >= opts.refork)
+    {
+      slm_refork();
+      fork_time = time(NULL);
+    }
+
     /* Select the client to run actual test */
     current = sl_succ(opts.cl_mode, current, opts.clients);
   }
@@ -424,6 +854,25 @@ static void slm_usage(const char* self)
   printf ("this application occupies required amount of memory and makes acceess\n");
   printf ("for reading and updating pages to generate load for virtual memory and swapping.\n");
   printf ("\n");
+  printf ("%s [-c] [-R fd] [-P pidfile] [-b backing] [-d dir] [-W secs] clients size duration type\n", self);
+  printf ("\n");
+  printf ("-b - memory which backs workset of clients, default is anon\n");
+  printf ("     anon    - private anonymous memory, swapped\n");
+  printf ("     file    - MAP_SHARED file, dirty pages written back to the file\n");
+  printf ("     private - MAP_PRIVATE file, clean pages re-read from the file\n");
+  printf ("     memfd   - shmem from memfd_create, swapped\n");
+  printf ("     sysv    - one SysV shm segment shared by all clients, swapped\n");
+  printf ("     cow     - region filled by controller before fork, every first\n");
+  printf ("               write of client is a copy-on-write fault\n");
+  printf ("-d - directory for file and private worksets, default is %s\n", SL_DIR);
+  printf ("-W - kill and fork all clients again every secs seconds, e.g. to\n");
+  printf ("     repeat copy-on-write faults like periodic snapshots do\n");
+  printf ("-c - report cycles, instructions, LLC/dTLB misses and page faults\n");
+  printf ("     of every client pass using perf_event_open\n");
+  printf ("-R - write readiness line to inherited descriptor when all clients\n");
+  printf ("     are initialized, READY=1 is also sent to $NOTIFY_SOCKET if set\n");
+  printf ("-P - create pidfile when all clients are initialized\n");
+  printf ("\n");
   printf ("%s can be invoked using the following mandatory parameters\n", self);
   printf ("in its command line:\n");
   printf ("- clients  - number of clients to be executed simultaneously\n");
@@ -438,6 +887,7 @@ static void slm_usage(const char* self)
   printf ("\n");
   printf ("examples:\n");
   printf ("  %s 8 128 120 LL - 8 clients, 128 MB per each, 120 seconds, lin/lin access\n", self);
+  printf ("  %s -b cow -W 30 4 1024 0 LR - 4 snapshot-like clients of 1 GB region, re-forked every 30 seconds\n", self);
   printf ("  %s 8 256 0 RP   - 8 clients, 256 MB per each, non-stop, random client selection, pseudo-random pages access\n", self);
 } /* slm_usage */
 
@@ -445,25 +895,71 @@ static void slm_usage(const char* self)
  * Main function.
  * ========================================================================= */
 
-int main(const int argc, const char* argv[])
+int main(const int argc, char* const argv[])
 {
   unsigned index;
-  pid_t    postfork;
+  int      want_counters = 0;
+  int      ready_fd = -1;
+  const char* pidfile = NULL;
+  SL_BACKING  backing = SL_Anon;
+  const char* dir     = SL_DIR;
+  time_t      refork  = 0;
+  int      c;
 
   this_epoch = time(NULL);
   this_pid   = getpid();
   pagesize   = (unsigned)getpagesize();
   printf ("stress paging/swapping load generator, build %s %s\n", __DATE__, __TIME__);
 
+  /* parse options */
+  opterr = 0;
+  while ((c = getopt(argc, argv, "cR:P:b:d:W:")) != -1)
+  {
+    switch (c)
+    {
+      case 'c':
+        want_counters = 1;
+        break;
+      case 'R':
+        ready_fd = atoi(optarg);
+        break;
+      case 'P':
+        pidfile = optarg;
+        break;
+      case 'b':
+        backing = slm_getbacking(optarg);
+        if (SL_BackingUnknown == backing)
+        {
+          slm_usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'd':
+        dir = optarg;
+        break;
+      case 'W':
+        refork = (time_t)atoi(optarg);
+        break;
+      default:
+        slm_usage(argv[0]);
+        return 1;
+    }
+  }
+
   /* validate parameters in general */
-  if (5 != argc)
+  if (4 != argc - optind)
   {
     slm_usage(argv[0]);
     return 1;
   }
+  argv += optind - 1;
 
   /* parse parameters one by one */
   memset(&opts, 0, sizeof(opts));
+  opts.counters = want_counters;
+  opts.backing  = backing;
+  opts.dir      = dir;
+  opts.refork   = refork;
   opts.clients = atoi(argv[1]);
   opts.workset = atoi(argv[2]) * (1024 * 1024 / pagesize);
   opts.t_limit = (time_t)atoi(argv[3]);
@@ -483,40 +979,21 @@ int main(const int argc, const char* argv[])
   }
 
   slm_dump_params();
+  if ((SL_Sysv == opts.backing || SL_Cow == opts.backing) && slm_share((size_t)opts.workset * pagesize) < 0)
+    return 1;
 
   /* initialize all clients */
   signal(SL_SIGTIME, sl_done_handler);
   signal(SL_SIGDONE, sl_done_handler);
   signal(SL_SIGINFO, sl_info_handler);
   opts.pids = (pid_t*) calloc(opts.clients, sizeof(pid_t));
+  nt_setup(ready_fd, pidfile);
 
   for (index = 0; index < opts.clients; index++)
-  {
-    printf ("%s creating test client %u\n", sl_this(), index + 1);
-
-    /* One more fork() usage example */
-    info_flag = 0;
-    postfork = fork();
-    switch (postfork)
-    {
-      case 0:   /* I am a child */
-          slc_init();
-          slc_main();
-          raise(SL_SIGDONE);
-        break;
-
-      case -1:  /* Bug happened */
-          printf ("%s error %d - %s\n", sl_this(), errno, strerror(errno));
-          raise(SL_SIGDONE);
-        break;
+    slm_spawn(index);
 
-      default:  /* I am a parent */
-          opts.pids[index] = postfork;
-          printf ("%s waiting for test client %u pid %u initialization\n", sl_this(), index + 1, postfork);
-          sl_wait_info();
-        break;
-    }
-  } /* for */
+  /* shared region is counted once */
+  nt_ready((SL_Sysv == opts.backing || SL_Cow == opts.backing ? 1 : opts.clients) * (unsigned)(((size_t)opts.workset * pagesize) >> 20));
 
   /* run the test */
   slm_main();